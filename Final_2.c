@@ -4,6 +4,14 @@
 #include <semaphore.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
+
+// Liveness watchdog; the relief policy comes from BAKERY_WATCHDOG
+#define WATCHDOG_TICK_MS 250
+#define WATCHDOG_MIN_STALL_S 3     // Stall limit floor; always more than one eating time
+#define WATCHDOG_MAX_RELIEF 3      // Reliefs tried before the run is ended
+
+typedef enum { RELIEF_OFF, RELIEF_END, RELIEF_EXEMPT, RELIEF_PAIR } ReliefPolicy;
 
 int RED_COUNT = 3;
 int BLUE_COUNT = 3;
@@ -15,31 +23,213 @@ int red_served = 0, blue_served = 0;
 pthread_mutex_t mutex;
 sem_t table_sem;
 
+// Progress counters and waiting gauges, all protected by mutex
+long entries = 0, departures = 0;
+int red_waiting = 0, blue_waiting = 0;
+int red_gave_up = 0, blue_gave_up = 0;
+double last_red_entry = 0, last_blue_entry = 0;
+
+// Relief state set by the watchdog, also protected by mutex
+ReliefPolicy relief_policy = RELIEF_END;
+int exempt_red = 0, exempt_blue = 0;     // Timed exemption from the balance rule
+double exempt_until = 0;
+int pair_passes = 0;                     // Red-blue pairs the watchdog lets past the balance rule
+int red_owed = 0, blue_owed = 0;         // Partners still to enter for a pair already started
+int closing = 0;                         // Run ended by the watchdog; waiters give up
+int watchdog_running = 1;
+
+double now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Whether the watchdog currently lets this color past the balance rule;
+ * caller holds mutex. A pair pass is only started when a partner of the
+ * other color is waiting too, and then that color owes one entry, so the
+ * pair goes in together; a lone customer keeps waiting for a partner.
+ */
+int relief_allows(int is_red)
+{
+    if ((is_red ? exempt_red : exempt_blue) && now_seconds() < exempt_until)
+    {
+        return 1;
+    }
+    if ((is_red ? red_owed : blue_owed) > 0)
+    {
+        return 1;                        // Our partner already went in
+    }
+    if (pair_passes > 0 && (is_red ? blue_waiting : red_waiting) > 0)
+    {
+        pair_passes--;
+        if (is_red) blue_owed++; else red_owed++;
+        return 1;
+    }
+    return 0;
+}
+
+// Count an entry; it completes a started pair whichever rule let it in. Caller holds mutex
+void note_entry(int is_red)
+{
+    int* owed = is_red ? &red_owed : &blue_owed;
+    if (*owed > 0)
+    {
+        (*owed)--;
+    }
+    entries++;
+    if (is_red) last_red_entry = now_seconds(); else last_blue_entry = now_seconds();
+}
+
+void dump_state(const char* reason, double stalled)
+{
+    printf("⚠️  Watchdog: %s for %.1f s\n", reason, stalled);
+    printf("    inside R=%d B=%d, waiting R=%d B=%d, served R=%d B=%d, entries %ld, departures %ld\n",
+           red_inside, blue_inside, red_waiting, blue_waiting, red_served, blue_served, entries, departures);
+}
+
+/*
+ * Watches the progress counters. If customers are waiting and nobody has
+ * entered or left for the stall limit, or one color has waited that long
+ * while the other keeps entering, it dumps the state and applies the
+ * relief policy. After WATCHDOG_MAX_RELIEF reliefs without progress (or at
+ * once with "end") it ends the run so waiters stop polling.
+ */
+void* watchdog(void* arg)
+{
+    (void)arg;
+    double stall_limit = EATING_TIME * 2 + 1;
+    if (stall_limit < WATCHDOG_MIN_STALL_S)
+    {
+        stall_limit = WATCHDOG_MIN_STALL_S;
+    }
+    long last_progress = -1;
+    double progress_at = now_seconds();
+    int reliefs = 0;
+
+    while (1)
+    {
+        usleep(WATCHDOG_TICK_MS * 1000);
+        pthread_mutex_lock(&mutex);
+        if (!watchdog_running || closing)
+        {
+            pthread_mutex_unlock(&mutex);
+            break;
+        }
+
+        double now = now_seconds();
+        long progress = entries + departures;
+        if (progress != last_progress || red_waiting + blue_waiting == 0)
+        {
+            last_progress = progress;
+            progress_at = now;
+        }
+
+        const char* reason = NULL;
+        int starving_red = 0, starving_blue = 0;
+        double stalled = now - progress_at;
+        if (stalled >= stall_limit)
+        {
+            reason = "no customer entered or left";
+            starving_red = red_waiting > 0;
+            starving_blue = blue_waiting > 0;
+        }
+        else if (red_waiting > 0 && now - last_red_entry >= stall_limit * 2)
+        {
+            reason = "red customers starving";
+            stalled = now - last_red_entry;
+            starving_red = 1;
+        }
+        else if (blue_waiting > 0 && now - last_blue_entry >= stall_limit * 2)
+        {
+            reason = "blue customers starving";
+            stalled = now - last_blue_entry;
+            starving_blue = 1;
+        }
+
+        if (reason != NULL && relief_policy != RELIEF_OFF)
+        {
+            dump_state(reason, stalled);
+            if (relief_policy == RELIEF_END || reliefs >= WATCHDOG_MAX_RELIEF)
+            {
+                printf("⚠️  Watchdog: ending the run; waiting customers go home\n");
+                closing = 1;
+                pthread_mutex_unlock(&mutex);
+                break;
+            }
+            if (relief_policy == RELIEF_EXEMPT)
+            {
+                exempt_red = starving_red;
+                exempt_blue = starving_blue;
+                exempt_until = now + stall_limit;
+                printf("⚠️  Watchdog: exempting %s from the balance rule for %.0f s\n",
+                       starving_red && starving_blue ? "both colors" : starving_red ? "red" : "blue",
+                       stall_limit);
+            }
+            else
+            {
+                pair_passes++;
+                printf("⚠️  Watchdog: letting one red-blue pair in together once both are waiting\n");
+            }
+            reliefs++;
+            progress_at = now;
+            if (starving_red) last_red_entry = now;
+            if (starving_blue) last_blue_entry = now;
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+    return NULL;
+}
+
 void* red_customer(void* arg) 
 {
     int id = *(int*)arg;
+    int waiting = 0;
     free(arg);
     
     while (1) 
     {
         pthread_mutex_lock(&mutex);
+        if (closing) 
+        {
+            red_waiting -= waiting;
+            red_gave_up++;
+            printf("🔴 Red %d gives up and goes home\n", id);
+            pthread_mutex_unlock(&mutex);
+            return NULL;
+        }
         if (red_inside < blue_inside) 
         {
             red_inside++;
             printf("🔴 Red %d entered (R=%d, B=%d)\n", id, red_inside, blue_inside);
-            pthread_mutex_unlock(&mutex);
-            break;
         } 
         else if (red_inside == 0 && blue_inside == 0) 
         {
             red_inside++;
             printf("🔴 Red %d (first customer) entered (R=%d, B=%d)\n", id, red_inside, blue_inside);
+        }
+        else if (relief_allows(1)) 
+        {
+            red_inside++;
+            printf("🔴 Red %d entered on watchdog relief (R=%d, B=%d)\n", id, red_inside, blue_inside);
+        }
+        else 
+        {
+            if (!waiting) 
+            {
+                waiting = 1;
+                red_waiting++;
+            }
             pthread_mutex_unlock(&mutex);
-            break;
+            printf("🔴 Red %d waiting to enter...\n", id);
+            usleep(100000);
+            continue;
         }
+        red_waiting -= waiting;
+        note_entry(1);
         pthread_mutex_unlock(&mutex);
-        printf("🔴 Red %d waiting to enter...\n", id);
-        usleep(100000);
+        break;
     }
     
     printf("🔴 Red %d waiting for a table...\n", id);
@@ -52,6 +242,7 @@ void* red_customer(void* arg)
     pthread_mutex_lock(&mutex);
     red_inside--;
     red_served++;
+    departures++;
     pthread_mutex_unlock(&mutex);
     sem_post(&table_sem);
     
@@ -61,28 +252,51 @@ void* red_customer(void* arg)
 void* blue_customer(void* arg) 
 {
     int id = *(int*)arg;
+    int waiting = 0;
     free(arg);
     
     while (1) 
     {
         pthread_mutex_lock(&mutex);
+        if (closing) 
+        {
+            blue_waiting -= waiting;
+            blue_gave_up++;
+            printf("🔵 Blue %d gives up and goes home\n", id);
+            pthread_mutex_unlock(&mutex);
+            return NULL;
+        }
         if (blue_inside < red_inside) 
         {
             blue_inside++;
             printf("🔵 Blue %d entered (R=%d, B=%d)\n", id, red_inside, blue_inside);
-            pthread_mutex_unlock(&mutex);
-            break;
         } 
         else if (red_inside == 0 && blue_inside == 0) 
         {
             blue_inside++;
             printf("🔵 Blue %d (first customer) entered (R=%d, B=%d)\n", id, red_inside, blue_inside);
+        }
+        else if (relief_allows(0)) 
+        {
+            blue_inside++;
+            printf("🔵 Blue %d entered on watchdog relief (R=%d, B=%d)\n", id, red_inside, blue_inside);
+        }
+        else 
+        {
+            if (!waiting) 
+            {
+                waiting = 1;
+                blue_waiting++;
+            }
             pthread_mutex_unlock(&mutex);
-            break;
+            printf("🔵 Blue %d waiting to enter...\n", id);
+            usleep(100000);
+            continue;
         }
+        blue_waiting -= waiting;
+        note_entry(0);
         pthread_mutex_unlock(&mutex);
-        printf("🔵 Blue %d waiting to enter...\n", id);
-        usleep(100000);
+        break;
     }
     
     printf("🔵 Blue %d waiting for a table...\n", id);
@@ -95,6 +309,7 @@ void* blue_customer(void* arg)
     pthread_mutex_lock(&mutex);
     blue_inside--;
     blue_served++;
+    departures++;
     pthread_mutex_unlock(&mutex);
     sem_post(&table_sem);
     
@@ -142,9 +357,20 @@ int main()
     printf("Available tables: %d\n", TABLES);
     printf("Eating time: %d second(s)\n\n", EATING_TIME);
     
-    pthread_t red[RED_COUNT], blue[BLUE_COUNT];
+    const char* policy = getenv("BAKERY_WATCHDOG");
+    if (policy != NULL)
+    {
+        if (strcmp(policy, "off") == 0) relief_policy = RELIEF_OFF;
+        else if (strcmp(policy, "exempt") == 0) relief_policy = RELIEF_EXEMPT;
+        else if (strcmp(policy, "pair") == 0) relief_policy = RELIEF_PAIR;
+        else relief_policy = RELIEF_END;
+    }
+    
+    pthread_t red[RED_COUNT], blue[BLUE_COUNT], watchdog_thread;
     pthread_mutex_init(&mutex, NULL);
     sem_init(&table_sem, 0, TABLES);
+    last_red_entry = last_blue_entry = now_seconds();
+    pthread_create(&watchdog_thread, NULL, watchdog, NULL);
     
     for (int a = 0; a < RED_COUNT; a++) 
     {
@@ -187,14 +413,30 @@ int main()
         pthread_join(blue[b], NULL);
     }
     
+    pthread_mutex_lock(&mutex);
+    watchdog_running = 0;
+    pthread_mutex_unlock(&mutex);
+    pthread_join(watchdog_thread, NULL);
+    
     pthread_mutex_destroy(&mutex);
     sem_destroy(&table_sem);
     
-    printf("\n🎉 All customers served. Bakery closed.\n");
+    if (red_gave_up + blue_gave_up > 0)
+    {
+        printf("\n⚠️  Run ended by the watchdog. Bakery closed.\n");
+    }
+    else
+    {
+        printf("\n🎉 All customers served. Bakery closed.\n");
+    }
     printf("Summary:\n");
     printf("- Red customers served: %d\n", red_served);
     printf("- Blue customers served: %d\n", blue_served);
     printf("- Total customers: %d\n", red_served + blue_served);
+    if (red_gave_up + blue_gave_up > 0)
+    {
+        printf("- Gave up waiting: %d red, %d blue\n", red_gave_up, blue_gave_up);
+    }
     
     return 0;
 }
@@ -5,14 +5,39 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
 #include <time.h>
 
 // Configuration will be set by user input
 int NUM_TABLES;
-int MAX_CUSTOMERS;
+int MAX_CUSTOMERS;  // Slots preallocated at startup; the table grows past it on demand
+
+#define MAX_STAY_SECONDS 8  // Seated customers past this are asked to leave
+
+// Waiting customers give up after PATIENCE_MIN..PATIENCE_MAX seconds, and arrivals
+// walk away at once if BALK_MIN..BALK_MAX of their color are already waiting
+#define PATIENCE_MIN_SECONDS 5
+#define PATIENCE_MAX_SECONDS 15
+#define BALK_MIN 3
+#define BALK_MAX 6
+
+// Activity log: a fixed ring, drawn one visible row at a time
+#define LOG_CAPACITY 4096  // Lines kept; older lines are overwritten
+#define LOG_LINE_LEN 128
+#define LOG_ROW_HEIGHT 18  // Pixels per drawn row
+#define LOG_REFRESH_MS 100  // How often the GTK thread picks up new lines
 
 typedef enum { RED, BLUE } CustomerColor;
 
+// Counter-based RNG stream: the n-th draw is a pure function of (key, n)
+typedef struct {
+    uint64_t key;
+    uint64_t counter;
+} RngStream;
+
 typedef struct {
     int id;
     CustomerColor color;
@@ -20,6 +45,17 @@ typedef struct {
     int table_num;
     GtkWidget *widget;
     time_t arrival_time;
+    time_t deadline;  // Seating time + MAX_STAY_SECONDS, key in expiry_heap
+    bool evicted;  // Asked to leave by check_customers(); its thread must not remove it again
+    RngStream rng;  // Private random stream for this visit
+    int heap_pos;  // Index in expiry_heap, -1 when not seated
+    _Atomic uint32_t next_free;  // Free-stack link (id + 1, 0 ends the stack)
+    sem_t admit;  // Posted when a waiting customer is let in
+    bool waiting;  // In its color's waiting line
+    int wait_prev;  // Waiting-line links (slot ids, -1 ends the line)
+    int wait_next;
+    int patience;  // Seconds this customer will wait before leaving
+    int balk_at;  // Walks away if this many of its color are already waiting
 } Customer;
 
 // Global Variables
@@ -29,11 +65,138 @@ pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 int red_count = 0;
 int blue_count = 0;
 int tables_used = 0;
+int *table_owner;  // Customer id seated at each table, -1 if free; protected by mutex
 int waiting_red = 0;
 int waiting_blue = 0;
+int wait_head[2] = { -1, -1 };  // Waiting lines per color, oldest first, protected by mutex
+int wait_tail[2] = { -1, -1 };
+int balked[2] = { 0, 0 };  // Customers who walked away on arrival, per color
+int reneged[2] = { 0, 0 };  // Customers who gave up after waiting, per color
 bool running = true;
+uint64_t sim_seed;
+atomic_long spawn_count = 0;  // Stream number for the next customer
+
+// Set up a fresh slot; called once per slot when its chunk is allocated
+static void slot_setup(Customer *slot) {
+    slot->in_bakery = false;
+    slot->table_num = -1;
+    slot->widget = NULL;
+    slot->heap_pos = -1;
+    slot->waiting = false;
+    sem_init(&slot->admit, 0, 0);  // Every post is consumed, so a reused slot starts at 0
+}
+
+// Tear down a slot when its chunk is freed at shutdown
+static void slot_teardown(Customer *slot) {
+    sem_destroy(&slot->admit);
+}
+
+// Customer slots live in fixed-size chunks, so growing the table never moves a
+// customer that a running thread points at. Free slots form a lock-free stack
+// whose head carries a generation tag, which makes slot reuse ABA-safe.
+// This block is identical in demo_gui1.c, src_GUI01.c and src_GUI2.c; what
+// differs per file lives in slot_setup() and slot_teardown() above it.
+#define SLOT_CHUNK 64
+#define MAX_SLOT_CHUNKS 4096
+
+Customer *slot_chunks[MAX_SLOT_CHUNKS];
+atomic_int slot_capacity = 0;
+_Atomic uint64_t free_slots = 0;  // (tag << 32) | (top id + 1); low half 0 means empty
+pthread_mutex_t grow_mutex = PTHREAD_MUTEX_INITIALIZER;  // Serialises chunk allocation only
+
+Customer *customer_at(int id) {
+    return &slot_chunks[id / SLOT_CHUNK][id % SLOT_CHUNK];
+}
+
+// Return a slot to the free stack
+void slot_free(int id) {
+    Customer *slot = customer_at(id);
+    uint64_t head = atomic_load(&free_slots);
+    uint64_t next;
+    do {
+        atomic_store_explicit(&slot->next_free, (uint32_t)head, memory_order_relaxed);
+        next = (((head >> 32) + 1) << 32) | (uint32_t)(id + 1);
+    } while (!atomic_compare_exchange_weak(&free_slots, &head, next));
+}
+
+// Pop a free slot; -1 if the stack is empty
+static int slot_pop(void) {
+    uint64_t head = atomic_load(&free_slots);
+    uint64_t next;
+    do {
+        uint32_t top = (uint32_t)head;
+        if (top == 0) {
+            return -1;
+        }
+        uint32_t below = atomic_load_explicit(&customer_at(top - 1)->next_free, memory_order_relaxed);
+        next = (((head >> 32) + 1) << 32) | below;
+    } while (!atomic_compare_exchange_weak(&free_slots, &head, next));
+    return (int)(uint32_t)head - 1;
+}
+
+// Add a chunk of fresh slots; false once MAX_SLOT_CHUNKS is reached
+static bool slot_grow(void) {
+    pthread_mutex_lock(&grow_mutex);
+    int base = atomic_load(&slot_capacity);
+    if (base / SLOT_CHUNK >= MAX_SLOT_CHUNKS) {
+        pthread_mutex_unlock(&grow_mutex);
+        return false;
+    }
+    Customer *chunk = (Customer*)calloc(SLOT_CHUNK, sizeof(Customer));
+    for (int j = 0; j < SLOT_CHUNK; j++) {
+        chunk[j].id = base + j;
+        slot_setup(&chunk[j]);
+    }
+    slot_chunks[base / SLOT_CHUNK] = chunk;
+    atomic_store(&slot_capacity, base + SLOT_CHUNK);
+    pthread_mutex_unlock(&grow_mutex);
+    
+    for (int j = SLOT_CHUNK - 1; j >= 0; j--) {
+        slot_free(base + j);
+    }
+    return true;
+}
+
+// Claim a customer slot in O(1), growing the table when it runs dry
+int slot_alloc(void) {
+    for (;;) {
+        int id = slot_pop();
+        if (id >= 0) {
+            return id;
+        }
+        if (!slot_grow()) {
+            return -1;
+        }
+    }
+}
+
+// Preallocate the slots requested at startup
+void slot_pool_init(int initial) {
+    while (atomic_load(&slot_capacity) < initial && slot_grow()) {
+    }
+}
+
+// Release every chunk at shutdown
+void slot_pool_destroy(void) {
+    int chunks = atomic_load(&slot_capacity) / SLOT_CHUNK;
+    for (int c = 0; c < chunks; c++) {
+        for (int j = 0; j < SLOT_CHUNK; j++) {
+            slot_teardown(&slot_chunks[c][j]);
+        }
+        free(slot_chunks[c]);
+    }
+}
+
+// Seated customers ordered by deadline, protected by mutex
+int *expiry_heap;
+int heap_size = 0;
+int heap_capacity = 0;
 
-Customer *customers;
+// Activity log ring. Any thread appends under log_mutex; only the GTK thread draws.
+char log_ring[LOG_CAPACITY][LOG_LINE_LEN];
+long log_total = 0;  // Lines ever appended; line n lives in log_ring[n % LOG_CAPACITY]
+pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+long log_shown = 0;  // log_total at the last refresh (GTK thread only)
 
 // GTK Widgets
 GtkWidget *window;
@@ -43,8 +206,8 @@ GtkWidget *tables_label;
 GtkWidget *bakery_grid;
 GtkWidget *queue_box;
 GtkWidget *status_label;
-GtkWidget *log_view;
-GtkTextBuffer *log_buffer;
+GtkWidget *log_area;
+GtkAdjustment *log_adjustment;
 GtkCssProvider *provider;
 GtkWidget **table_widgets;
 
@@ -53,22 +216,92 @@ void create_customer(CustomerColor color);
 void create_ui(void);
 gboolean update_ui(gpointer data);
 void log_activity(const char *message);
+void expiry_push(int id);
+void expiry_remove(int id);
+void admit_waiting(void);
 
+// Append a line to the log ring; safe from any thread and never touches GTK
 void log_activity(const char *message) {
-    GtkTextIter end;
     char timestamp[20];
+    struct tm local;
     time_t now = time(NULL);
-    strftime(timestamp, sizeof(timestamp), "%H:%M:%S", localtime(&now));
+    strftime(timestamp, sizeof(timestamp), "%H:%M:%S", localtime_r(&now, &local));
     
-    char full_message[256];
-    sprintf(full_message, "[%s] %s\n", timestamp, message);
+    pthread_mutex_lock(&log_mutex);
+    snprintf(log_ring[log_total % LOG_CAPACITY], LOG_LINE_LEN, "[%s] %s", timestamp, message);
+    log_total++;
+    pthread_mutex_unlock(&log_mutex);
+}
+
+// Draw only the rows that fall inside the visible window
+gboolean on_log_draw(GtkWidget *widget, cairo_t *cr, gpointer data) {
+    int height = gtk_widget_get_allocated_height(widget);
+    double offset = gtk_adjustment_get_value(log_adjustment);
+    PangoLayout *layout = gtk_widget_create_pango_layout(widget, NULL);
     
-    gtk_text_buffer_get_end_iter(log_buffer, &end);
-    gtk_text_buffer_insert(log_buffer, &end, full_message, -1);
+    pthread_mutex_lock(&log_mutex);
+    long first_kept = log_total > LOG_CAPACITY ? log_total - LOG_CAPACITY : 0;
+    long first = first_kept + (long)(offset / LOG_ROW_HEIGHT);
+    long last = first + height / LOG_ROW_HEIGHT + 2;
+    if (last > log_total) {
+        last = log_total;
+    }
+    for (long line = first; line < last; line++) {
+        pango_layout_set_text(layout, log_ring[line % LOG_CAPACITY], -1);
+        cairo_move_to(cr, 4, (line - first_kept) * LOG_ROW_HEIGHT - offset);
+        pango_cairo_show_layout(cr, layout);
+    }
+    pthread_mutex_unlock(&log_mutex);
     
-    // Auto-scroll to bottom
-    GtkTextMark *mark = gtk_text_buffer_get_insert(log_buffer);
-    gtk_text_view_scroll_to_mark(GTK_TEXT_VIEW(log_view), mark, 0.0, TRUE, 0.0, 1.0);
+    g_object_unref(layout);
+    return FALSE;
+}
+
+// Pick up new lines: resize the scroll range and follow the tail if already there
+gboolean refresh_log(gpointer data) {
+    pthread_mutex_lock(&log_mutex);
+    long total = log_total;
+    pthread_mutex_unlock(&log_mutex);
+    
+    double page = gtk_widget_get_allocated_height(log_area);
+    double upper = (total < LOG_CAPACITY ? total : LOG_CAPACITY) * (double)LOG_ROW_HEIGHT;
+    double value = gtk_adjustment_get_value(log_adjustment);
+    bool at_tail = value + gtk_adjustment_get_page_size(log_adjustment) >=
+                   gtk_adjustment_get_upper(log_adjustment) - LOG_ROW_HEIGHT;
+    
+    if (total == log_shown && page == gtk_adjustment_get_page_size(log_adjustment)) {
+        return G_SOURCE_CONTINUE;
+    }
+    log_shown = total;
+    
+    if (at_tail) {
+        value = upper - page;
+    }
+    if (value < 0) {
+        value = 0;
+    }
+    gtk_adjustment_configure(log_adjustment, value, 0, upper, LOG_ROW_HEIGHT, page, page);
+    gtk_widget_queue_draw(log_area);
+    return G_SOURCE_CONTINUE;
+}
+
+void on_log_scrolled(GtkAdjustment *adjustment, gpointer data) {
+    gtk_widget_queue_draw(log_area);
+}
+
+// Mouse wheel over the drawing area scrolls the shared adjustment
+gboolean on_log_scroll_event(GtkWidget *widget, GdkEventScroll *event, gpointer data) {
+    double step = 3 * LOG_ROW_HEIGHT;
+    double value = gtk_adjustment_get_value(log_adjustment);
+    if (event->direction == GDK_SCROLL_UP) {
+        value -= step;
+    } else if (event->direction == GDK_SCROLL_DOWN) {
+        value += step;
+    } else if (event->direction == GDK_SCROLL_SMOOTH) {
+        value += event->delta_y * step;
+    }
+    gtk_adjustment_set_value(log_adjustment, value);  // Clamped by GTK
+    return TRUE;
 }
 
 void apply_css(GtkWidget *widget, const char *class_name) {
@@ -125,6 +358,32 @@ void setup_css() {
     );
 }
 
+// SplitMix64 finalizer: a strong 64-bit bijective mix
+uint64_t rng_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Derive an independent stream from a seed and a stream number
+RngStream rng_stream(uint64_t seed, uint64_t stream_id) {
+    RngStream stream = { rng_mix(seed ^ rng_mix(stream_id + 0x9E3779B97F4A7C15ULL)), 0 };
+    return stream;
+}
+
+// Next 64-bit draw; streams share no state, so threads never contend
+uint64_t rng_next(RngStream *stream) {
+    return rng_mix(stream->key + ++stream->counter * 0x9E3779B97F4A7C15ULL);
+}
+
+// Seed from BAKERY_SEED, or from the clock (printed so the run can be replayed)
+uint64_t choose_seed() {
+    const char *seed_env = getenv("BAKERY_SEED");
+    uint64_t seed = seed_env ? strtoull(seed_env, NULL, 10) : (uint64_t)time(NULL);
+    printf("Seed: %llu (set BAKERY_SEED to replay)\n", (unsigned long long)seed);
+    return seed;
+}
+
 // Callback functions
 void on_add_red_clicked(GtkWidget *widget, gpointer data) 
 {
@@ -135,13 +394,79 @@ void on_add_blue_clicked(GtkWidget *widget, gpointer data) {
     create_customer(BLUE);
 }
 
-bool is_table_occupied(int table_num) {
-    for (int i = 0; i < MAX_CUSTOMERS; i++) {
-        if (customers[i].in_bakery && customers[i].table_num == table_num) {
-            return true;
+// Swap two heap slots and keep heap_pos in step
+static void heap_swap(int a, int b) {
+    int tmp = expiry_heap[a];
+    expiry_heap[a] = expiry_heap[b];
+    expiry_heap[b] = tmp;
+    customer_at(expiry_heap[a])->heap_pos = a;
+    customer_at(expiry_heap[b])->heap_pos = b;
+}
+
+static void heap_sift_up(int pos) {
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (customer_at(expiry_heap[parent])->deadline <= customer_at(expiry_heap[pos])->deadline) {
+            break;
         }
+        heap_swap(pos, parent);
+        pos = parent;
+    }
+}
+
+static void heap_sift_down(int pos) {
+    for (;;) {
+        int smallest = pos;
+        int left = 2 * pos + 1;
+        int right = left + 1;
+        if (left < heap_size && customer_at(expiry_heap[left])->deadline < customer_at(expiry_heap[smallest])->deadline) {
+            smallest = left;
+        }
+        if (right < heap_size && customer_at(expiry_heap[right])->deadline < customer_at(expiry_heap[smallest])->deadline) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            return;
+        }
+        heap_swap(pos, smallest);
+        pos = smallest;
     }
-    return false;
+}
+
+// Track a newly seated customer's deadline, counted from now; caller holds mutex
+void expiry_push(int id) {
+    if (customer_at(id)->heap_pos >= 0) {
+        return;
+    }
+    customer_at(id)->deadline = time(NULL) + MAX_STAY_SECONDS;  // Time spent waiting does not count
+    if (heap_size == heap_capacity) {
+        heap_capacity = heap_capacity > 0 ? heap_capacity * 2 : SLOT_CHUNK;
+        expiry_heap = (int*)realloc(expiry_heap, heap_capacity * sizeof(int));
+    }
+    expiry_heap[heap_size] = id;
+    customer_at(id)->heap_pos = heap_size;
+    heap_size++;
+    heap_sift_up(heap_size - 1);
+}
+
+// Forget a customer's deadline in O(log n); caller holds mutex
+void expiry_remove(int id) {
+    int pos = customer_at(id)->heap_pos;
+    if (pos < 0) {
+        return;
+    }
+    heap_size--;
+    if (pos != heap_size) {
+        heap_swap(pos, heap_size);
+        heap_sift_down(pos);
+        heap_sift_up(pos);
+    }
+    customer_at(id)->heap_pos = -1;
+}
+
+// O(1): seating and leaving keep table_owner up to date
+bool is_table_occupied(int table_num) {
+    return table_owner[table_num] >= 0;
 }
 
 void create_customer_widget(Customer *customer) {
@@ -201,10 +526,12 @@ void remove_customer(Customer *customer) {
     
     if (customer->table_num >= 0) {
         tables_used--;
+        table_owner[customer->table_num] = -1;
         customer->table_num = -1;
     }
     
     customer->in_bakery = false;
+    expiry_remove(customer->id);
     
     char log_msg[100];
     sprintf(log_msg, "%s customer %d left the bakery", 
@@ -212,31 +539,125 @@ void remove_customer(Customer *customer) {
     log_activity(log_msg);
 }
 
+// Waiting customers of a color; caller holds mutex
+static int *waiting_count(CustomerColor color) {
+    return color == RED ? &waiting_red : &waiting_blue;
+}
+
+// Join the tail of the color's waiting line in O(1); caller holds mutex
+static void wait_link(Customer *customer) {
+    int color = customer->color;
+    customer->waiting = true;
+    customer->wait_next = -1;
+    customer->wait_prev = wait_tail[color];
+    if (wait_tail[color] >= 0) {
+        customer_at(wait_tail[color])->wait_next = customer->id;
+    } else {
+        wait_head[color] = customer->id;
+    }
+    wait_tail[color] = customer->id;
+    (*waiting_count(customer->color))++;
+}
+
+// Leave the waiting line from wherever the customer stands, in O(1); caller holds mutex
+static void wait_unlink(Customer *customer) {
+    int color = customer->color;
+    if (customer->wait_prev >= 0) {
+        customer_at(customer->wait_prev)->wait_next = customer->wait_next;
+    } else {
+        wait_head[color] = customer->wait_next;
+    }
+    if (customer->wait_next >= 0) {
+        customer_at(customer->wait_next)->wait_prev = customer->wait_prev;
+    } else {
+        wait_tail[color] = customer->wait_prev;
+    }
+    customer->waiting = false;
+    (*waiting_count(customer->color))--;
+}
+
+// Let in the oldest waiters whose color the balance rule now allows; caller holds mutex
+void admit_waiting(void) {
+    bool admitted = true;
+    while (admitted) {
+        admitted = false;
+        if (wait_head[RED] >= 0 && red_count <= blue_count) {
+            Customer *customer = customer_at(wait_head[RED]);
+            wait_unlink(customer);
+            red_count++;  // Counted in now, so the next check sees the new balance
+            sem_post(&customer->admit);
+            admitted = true;
+        }
+        if (wait_head[BLUE] >= 0 && blue_count <= red_count) {
+            Customer *customer = customer_at(wait_head[BLUE]);
+            wait_unlink(customer);
+            blue_count++;
+            sem_post(&customer->admit);
+            admitted = true;
+        }
+    }
+}
+
+// Block until admitted or out of patience; false on timeout
+static bool wait_admitted(Customer *customer) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);  // sem_timedwait() measures against the realtime clock
+    deadline.tv_sec += customer->patience;
+    while (sem_timedwait(&customer->admit, &deadline) != 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void *customer_thread(void *arg) {
     Customer *customer = (Customer *)arg;
+    const char *name = customer->color == RED ? "Red" : "Blue";
     char log_msg[100];
     
     pthread_mutex_lock(&mutex);
-    if (customer->color == RED) {
-        if (red_count > blue_count) {
-            waiting_red++;
-            sprintf(log_msg, "Red customer %d waiting (Red: %d, Blue: %d)", 
-                    customer->id, red_count, blue_count);
+    int *own_count = customer->color == RED ? &red_count : &blue_count;
+    int *other_count = customer->color == RED ? &blue_count : &red_count;
+    if (*own_count > *other_count) {
+        if (*waiting_count(customer->color) >= customer->balk_at) {
+            balked[customer->color]++;
+            sprintf(log_msg, "%s customer %d walked away: %d already waiting", 
+                    name, customer->id, *waiting_count(customer->color));
             log_activity(log_msg);
             pthread_mutex_unlock(&mutex);
+            slot_free(customer->id);
             return NULL;
         }
-        red_count++;
-    } else {
-        if (blue_count > red_count) {
-            waiting_blue++;
-            sprintf(log_msg, "Blue customer %d waiting (Red: %d, Blue: %d)", 
-                    customer->id, red_count, blue_count);
-            log_activity(log_msg);
+        
+        wait_link(customer);
+        sprintf(log_msg, "%s customer %d waiting (Red: %d, Blue: %d)", 
+                name, customer->id, red_count, blue_count);
+        log_activity(log_msg);
+        pthread_mutex_unlock(&mutex);
+        
+        if (!wait_admitted(customer)) {
+            pthread_mutex_lock(&mutex);
+            if (customer->waiting) {
+                wait_unlink(customer);
+                reneged[customer->color]++;
+                sprintf(log_msg, "%s customer %d gave up after waiting %d s", 
+                        name, customer->id, customer->patience);
+                log_activity(log_msg);
+                pthread_mutex_unlock(&mutex);
+                slot_free(customer->id);
+                return NULL;
+            }
+            // Admitted just as patience ran out; the post is already there
             pthread_mutex_unlock(&mutex);
-            return NULL;
+            sem_wait(&customer->admit);
         }
-        blue_count++;
+        
+        // admit_waiting() counted this customer in
+        pthread_mutex_lock(&mutex);
+    } else {
+        (*own_count)++;
+        admit_waiting();
     }
     
     create_customer_widget(customer);
@@ -249,7 +670,9 @@ void *customer_thread(void *arg) {
         if (!is_table_occupied(i)) {
             customer->table_num = i;
             customer->in_bakery = true;
+            table_owner[i] = customer->id;
             tables_used++;
+            expiry_push(customer->id);
             move_to_table(customer);
             break;
         }
@@ -257,47 +680,39 @@ void *customer_thread(void *arg) {
     pthread_mutex_unlock(&mutex);
     
     // Customer stays for 3-8 seconds
-    sleep(3 + (rand() % 5));
+    sleep(3 + (int)(rng_next(&customer->rng) % 5));
     
     pthread_mutex_lock(&mutex);
-    remove_customer(customer);
-    
-    // Check waiting customers
-    if (customer->color == RED && waiting_blue > 0) {
-        waiting_blue--;
-        create_customer(BLUE);
-    } else if (customer->color == BLUE && waiting_red > 0) {
-        waiting_red--;
-        create_customer(RED);
+    if (!customer->evicted) {
+        remove_customer(customer);
+        admit_waiting();
     }
-    
     pthread_mutex_unlock(&mutex);
     
     sem_post(&tables_sem);
+    slot_free(customer->id);
     return NULL;
 }
 
 void create_customer(CustomerColor color) {
     pthread_t thread;
-    int id = -1;
-    
-    pthread_mutex_lock(&mutex);
-    for (int i = 0; i < MAX_CUSTOMERS; i++) {
-        if (!customers[i].in_bakery && customers[i].widget == NULL) {
-            id = i;
-            break;
-        }
+    int id = slot_alloc();  // Lock-free; the new slot is ours alone until the thread starts
+    if (id == -1) {
+        return;
     }
     
-    if (id != -1) {
-        customers[id].color = color;
-        customers[id].in_bakery = false;
-        customers[id].table_num = -1;
-        customers[id].arrival_time = time(NULL);
-        pthread_create(&thread, NULL, customer_thread, &customers[id]);
-        pthread_detach(thread);
-    }
-    pthread_mutex_unlock(&mutex);
+    Customer *customer = customer_at(id);
+    customer->color = color;
+    customer->in_bakery = false;
+    customer->table_num = -1;
+    customer->rng = rng_stream(sim_seed, atomic_fetch_add(&spawn_count, 1));
+    customer->arrival_time = time(NULL);
+    customer->evicted = false;
+    customer->patience = PATIENCE_MIN_SECONDS +
+        (int)(rng_next(&customer->rng) % (PATIENCE_MAX_SECONDS - PATIENCE_MIN_SECONDS + 1));
+    customer->balk_at = BALK_MIN + (int)(rng_next(&customer->rng) % (BALK_MAX - BALK_MIN + 1));
+    pthread_create(&thread, NULL, customer_thread, customer);
+    pthread_detach(thread);
 }
 
 void create_ui() {
@@ -325,10 +740,12 @@ void create_ui() {
     red_count_label = gtk_label_new("Red Customers: 0");
     blue_count_label = gtk_label_new("Blue Customers: 0");
     tables_label = gtk_label_new("Tables Used: 0/0");
+    status_label = gtk_label_new("Abandoned: 0");
     
     gtk_box_pack_start(GTK_BOX(info_box), red_count_label, TRUE, TRUE, 5);
     gtk_box_pack_start(GTK_BOX(info_box), blue_count_label, TRUE, TRUE, 5);
     gtk_box_pack_start(GTK_BOX(info_box), tables_label, TRUE, TRUE, 5);
+    gtk_box_pack_start(GTK_BOX(info_box), status_label, TRUE, TRUE, 5);
     gtk_box_pack_start(GTK_BOX(main_box), info_box, FALSE, FALSE, 5);
     
     // Content area (tables and queue)
@@ -380,18 +797,22 @@ void create_ui() {
     GtkWidget *log_label = gtk_label_new("Activity Log");
     gtk_box_pack_start(GTK_BOX(main_box), log_label, FALSE, FALSE, 5);
     
-    GtkWidget *log_scroll = gtk_scrolled_window_new(NULL, NULL);
-    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(log_scroll),
-                                  GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
-    gtk_widget_set_size_request(log_scroll, -1, 150);
+    // Virtualized view: the drawing area paints visible rows, the scrollbar spans the ring
+    GtkWidget *log_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+    gtk_widget_set_size_request(log_box, -1, 150);
     
-    log_view = gtk_text_view_new();
-    gtk_text_view_set_editable(GTK_TEXT_VIEW(log_view), FALSE);
-    gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(log_view), GTK_WRAP_WORD_CHAR);
-    log_buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(log_view));
+    log_adjustment = gtk_adjustment_new(0, 0, 0, LOG_ROW_HEIGHT, 150, 150);
+    g_signal_connect(log_adjustment, "value-changed", G_CALLBACK(on_log_scrolled), NULL);
     
-    gtk_container_add(GTK_CONTAINER(log_scroll), log_view);
-    gtk_box_pack_start(GTK_BOX(main_box), log_scroll, FALSE, FALSE, 5);
+    log_area = gtk_drawing_area_new();
+    gtk_widget_add_events(log_area, GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK);
+    g_signal_connect(log_area, "draw", G_CALLBACK(on_log_draw), NULL);
+    g_signal_connect(log_area, "scroll-event", G_CALLBACK(on_log_scroll_event), NULL);
+    
+    GtkWidget *log_scrollbar = gtk_scrollbar_new(GTK_ORIENTATION_VERTICAL, log_adjustment);
+    gtk_box_pack_start(GTK_BOX(log_box), log_area, TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(log_box), log_scrollbar, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(main_box), log_box, FALSE, FALSE, 5);
     
     // Control buttons
     GtkWidget *button_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
@@ -409,66 +830,463 @@ void create_ui() {
 }
 
 gboolean update_ui(gpointer data) {
-    char buffer[32];
+    char buffer[96];
     
-    sprintf(buffer, "Red Customers: %d (%d waiting)", red_count, waiting_red);
+    sprintf(buffer, "Red Customers: %d (%d waiting, %d left)", red_count, waiting_red,
+            balked[RED] + reneged[RED]);
     gtk_label_set_text(GTK_LABEL(red_count_label), buffer);
     
-    sprintf(buffer, "Blue Customers: %d (%d waiting)", blue_count, waiting_blue);
+    sprintf(buffer, "Blue Customers: %d (%d waiting, %d left)", blue_count, waiting_blue,
+            balked[BLUE] + reneged[BLUE]);
     gtk_label_set_text(GTK_LABEL(blue_count_label), buffer);
     
     sprintf(buffer, "Tables Used: %d/%d", tables_used, NUM_TABLES);
     gtk_label_set_text(GTK_LABEL(tables_label), buffer);
     
+    // Abandonment rate over every customer that has arrived
+    long arrivals = atomic_load(&spawn_count);
+    int abandoned = balked[RED] + balked[BLUE] + reneged[RED] + reneged[BLUE];
+    sprintf(buffer, "Abandoned: %d balked, %d reneged (%.0f%%)", balked[RED] + balked[BLUE],
+            reneged[RED] + reneged[BLUE], arrivals > 0 ? 100.0 * abandoned / arrivals : 0.0);
+    gtk_label_set_text(GTK_LABEL(status_label), buffer);
+    
     return G_SOURCE_CONTINUE;
 }
 
+// Enforce the maximum stay: only customers whose deadline has passed are touched
 gboolean check_customers(gpointer data) {
+    time_t now = time(NULL);
     pthread_mutex_lock(&mutex);
-    for (int i = 0; i < MAX_CUSTOMERS; i++) {
-        if (customers[i].in_bakery) {
-            time_t now = time(NULL);
-            if (now - customers[i].arrival_time >= 8) { // Maximum stay time
-                remove_customer(&customers[i]);
-                
-                // Check waiting customers
-                if (customers[i].color == RED && waiting_blue > 0) {
-                    waiting_blue--;
-                    create_customer(BLUE);
-                } else if (customers[i].color == BLUE && waiting_red > 0) {
-                    waiting_red--;
-                    create_customer(RED);
-                }
+    while (heap_size > 0 && customer_at(expiry_heap[0])->deadline <= now) {
+        Customer *customer = customer_at(expiry_heap[0]);
+        customer->evicted = true;  // Its thread still wakes up, but must not count it out twice
+        remove_customer(customer);  // Also pops it from the heap
+        admit_waiting();
+    }
+    pthread_mutex_unlock(&mutex);
+    return G_SOURCE_CONTINUE;
+}
+
+// Turbo stays match the threaded customers (3-7 s)
+#define TURBO_STAY_MIN 3
+#define TURBO_STAY_MAX 7
+
+// Turbo mode (--turbo SPEED): headless engine in virtual time, sampled by the UI.
+// This block is identical in demo_gui1.c, src_GUI01.c and src_GUI2.c; each file
+// defines TURBO_STAY_MIN/MAX above it and turbo_joins()/turbo_admit() below it.
+#define MAX_TURBO_TABLES 1024
+#define TURBO_FRAME_MS 33        // Display samples the engine at ~30 fps
+#define TURBO_PUBLISH_EVENTS 4096  // Engine publishes a snapshot at least this often
+#define HEAT_COLUMNS 240         // Frames of history shown in the heat-map
+
+// Turbo engine state, owned by the engine thread
+typedef struct {
+    double time;                 // Virtual seconds
+    int table;
+} TurboDeparture;
+
+// What the display sees of the turbo engine; published under a seqlock
+typedef struct {
+    double virtual_time;
+    double events_per_second;    // Engine rate over the last publish interval
+    long arrivals;
+    long served;
+    long walked_away;            // Arrivals that turbo_joins() turned away
+    int red_inside;
+    int blue_inside;
+    long red_waiting;
+    long blue_waiting;
+    int8_t table_color[MAX_TURBO_TABLES];  // -1 empty, else CustomerColor
+} TurboSnapshot;
+
+int turbo_tables = 64;
+double turbo_speed = -1;         // Virtual seconds per real second; 0 = unthrottled, <0 = off
+double turbo_arrival_ms = 50;    // Mean virtual time between arrivals
+atomic_bool turbo_running;
+atomic_uint snapshot_seq;        // Odd while the engine is writing
+TurboSnapshot snapshot;
+TurboSnapshot frame;             // Last snapshot read by the GTK thread
+int8_t heat[HEAT_COLUMNS][MAX_TURBO_TABLES + 2];  // History; last two rows are queue pressure
+int heat_head = 0;
+GtkWidget *heat_area;
+GtkWidget *turbo_label;
+
+// Per-file rules: whether an arrival joins the line, and which color to seat next (-1: none)
+static bool turbo_joins(const TurboSnapshot *state, CustomerColor color, RngStream *rng);
+static int turbo_admit(const TurboSnapshot *state);
+
+// Seqlock writer: readers retry instead of ever blocking the engine
+static void publish_snapshot(const TurboSnapshot *state) {
+    atomic_fetch_add_explicit(&snapshot_seq, 1, memory_order_acq_rel);
+    atomic_thread_fence(memory_order_release);
+    snapshot = *state;
+    atomic_fetch_add_explicit(&snapshot_seq, 1, memory_order_release);
+}
+
+// Seqlock reader (GTK thread); false if the engine kept it busy
+static bool read_snapshot(TurboSnapshot *out) {
+    for (int attempt = 0; attempt < 100; attempt++) {
+        unsigned before = atomic_load_explicit(&snapshot_seq, memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        *out = snapshot;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&snapshot_seq, memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double rng_unit(RngStream *stream) {
+    return (rng_next(stream) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Departure min-heap helpers (engine thread only)
+static void departure_push(TurboDeparture *heap, int *size, TurboDeparture d) {
+    int pos = (*size)++;
+    while (pos > 0 && heap[(pos - 1) / 2].time > d.time) {
+        heap[pos] = heap[(pos - 1) / 2];
+        pos = (pos - 1) / 2;
+    }
+    heap[pos] = d;
+}
+
+static TurboDeparture departure_pop(TurboDeparture *heap, int *size) {
+    TurboDeparture top = heap[0];
+    TurboDeparture last = heap[--(*size)];
+    int pos = 0;
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= *size) {
+            break;
+        }
+        if (child + 1 < *size && heap[child + 1].time < heap[child].time) {
+            child++;
+        }
+        if (last.time <= heap[child].time) {
+            break;
+        }
+        heap[pos] = heap[child];
+        pos = child;
+    }
+    heap[pos] = last;
+    return top;
+}
+
+// Engine thread: this file's rules (turbo_joins, turbo_admit), run as discrete events in virtual time
+void *turbo_engine(void *arg) {
+    TurboSnapshot state = { 0 };
+    TurboDeparture *departures = g_new(TurboDeparture, turbo_tables);
+    int *free_tables = g_new(int, turbo_tables);
+    int departure_count = 0;
+    int free_count = turbo_tables;
+    RngStream arrivals_rng = rng_stream(sim_seed, 1);
+    RngStream stay_rng = rng_stream(sim_seed, 2);
+    RngStream color_rng = rng_stream(sim_seed, 3);
+    RngStream join_rng = rng_stream(sim_seed, 4);
+    
+    for (int i = 0; i < turbo_tables; i++) {
+        state.table_color[i] = -1;
+        free_tables[i] = turbo_tables - 1 - i;
+    }
+    
+    double next_arrival = 0;
+    double real_start = monotonic_seconds();
+    double last_publish = real_start;
+    long events = 0;
+    long events_at_publish = 0;
+    
+    while (atomic_load_explicit(&turbo_running, memory_order_relaxed)) {
+        // Next event: the earlier of the next arrival and the next departure
+        if (departure_count > 0 && departures[0].time <= next_arrival) {
+            TurboDeparture d = departure_pop(departures, &departure_count);
+            state.virtual_time = d.time;
+            if (state.table_color[d.table] == RED) {
+                state.red_inside--;
+            } else {
+                state.blue_inside--;
+            }
+            state.table_color[d.table] = -1;
+            free_tables[free_count++] = d.table;
+            state.served++;
+        } else {
+            state.virtual_time = next_arrival;
+            CustomerColor color = (rng_next(&color_rng) >> 63) ? BLUE : RED;
+            if (!turbo_joins(&state, color, &join_rng)) {
+                state.walked_away++;
+            } else if (color == BLUE) {
+                state.blue_waiting++;
+            } else {
+                state.red_waiting++;
             }
+            state.arrivals++;
+            next_arrival += rng_unit(&arrivals_rng) * 2 * turbo_arrival_ms / 1000.0;
+        }
+        events++;
+        
+        // Admission: seat whoever this file's rule lets in while tables are free
+        while (free_count > 0) {
+            int color = turbo_admit(&state);
+            if (color == RED) {
+                state.red_waiting--;
+                state.red_inside++;
+            } else if (color == BLUE) {
+                state.blue_waiting--;
+                state.blue_inside++;
+            } else {
+                break;
+            }
+            int table = free_tables[--free_count];
+            state.table_color[table] = color;
+            double stay = TURBO_STAY_MIN + rng_unit(&stay_rng) * (TURBO_STAY_MAX - TURBO_STAY_MIN);
+            TurboDeparture d = { state.virtual_time + stay, table };
+            departure_push(departures, &departure_count, d);
+        }
+        
+        // Pace virtual time against the wall clock when a speed is set
+        double ahead = 0;
+        if (turbo_speed > 0) {
+            ahead = state.virtual_time / turbo_speed - (monotonic_seconds() - real_start);
+        }
+        if (ahead > 0 || events - events_at_publish >= TURBO_PUBLISH_EVENTS) {
+            double now = monotonic_seconds();
+            if (now > last_publish) {
+                state.events_per_second = (events - events_at_publish) / (now - last_publish);
+            }
+            publish_snapshot(&state);
+            last_publish = now;
+            events_at_publish = events;
+        }
+        if (ahead > 0) {
+            usleep(ahead > 0.005 ? 5000 : (useconds_t)(ahead * 1e6));
         }
     }
-    pthread_mutex_unlock(&mutex);
+    
+    g_free(departures);
+    g_free(free_tables);
+    return NULL;
+}
+
+// Pressure of a queue as a 0..100 shade, log-scaled so long queues stay distinguishable
+static int8_t queue_shade(long waiting) {
+    int shade = 0;
+    while (waiting > 0 && shade < 100) {
+        waiting >>= 1;
+        shade += 6;
+    }
+    return shade > 100 ? 100 : shade;
+}
+
+// Frame tick: sample the latest snapshot, push one heat-map column, update labels
+gboolean turbo_frame(gpointer data) {
+    if (!read_snapshot(&frame)) {
+        return G_SOURCE_CONTINUE;  // Try again next frame
+    }
+    
+    int8_t *column = heat[heat_head];
+    for (int t = 0; t < turbo_tables; t++) {
+        column[t] = frame.table_color[t];
+    }
+    column[turbo_tables] = queue_shade(frame.red_waiting);
+    column[turbo_tables + 1] = queue_shade(frame.blue_waiting);
+    heat_head = (heat_head + 1) % HEAT_COLUMNS;
+    
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "t = %.0f s virtual | %.2f M events/s | arrived %ld, served %ld, walked away %ld | "
+             "inside %d red / %d blue | waiting %ld red / %ld blue",
+             frame.virtual_time, frame.events_per_second / 1e6, frame.arrivals, frame.served,
+             frame.walked_away, frame.red_inside, frame.blue_inside, frame.red_waiting, frame.blue_waiting);
+    gtk_label_set_text(GTK_LABEL(turbo_label), buffer);
+    gtk_widget_queue_draw(heat_area);
     return G_SOURCE_CONTINUE;
 }
 
+// Heat-map: one column per frame, one row per table, then red and blue queue pressure
+gboolean on_heat_draw(GtkWidget *widget, cairo_t *cr, gpointer data) {
+    int width = gtk_widget_get_allocated_width(widget);
+    int height = gtk_widget_get_allocated_height(widget);
+    int rows = turbo_tables + 2;
+    double cell_w = (double)width / HEAT_COLUMNS;
+    double cell_h = (double)height / rows;
+    
+    cairo_set_source_rgb(cr, 0.93, 0.93, 0.93);
+    cairo_paint(cr);
+    
+    for (int c = 0; c < HEAT_COLUMNS; c++) {
+        int8_t *column = heat[(heat_head + c) % HEAT_COLUMNS];  // Oldest on the left
+        for (int r = 0; r < turbo_tables; r++) {
+            if (column[r] < 0) {
+                continue;
+            }
+            if (column[r] == RED) {
+                cairo_set_source_rgb(cr, 0.9, 0.25, 0.25);
+            } else {
+                cairo_set_source_rgb(cr, 0.25, 0.35, 0.9);
+            }
+            cairo_rectangle(cr, c * cell_w, r * cell_h, cell_w + 0.5, cell_h + 0.5);
+            cairo_fill(cr);
+        }
+        for (int q = 0; q < 2; q++) {
+            double shade = column[turbo_tables + q] / 100.0;
+            if (q == 0) {
+                cairo_set_source_rgb(cr, 1.0, 1.0 - shade, 1.0 - shade);
+            } else {
+                cairo_set_source_rgb(cr, 1.0 - shade, 1.0 - shade, 1.0);
+            }
+            cairo_rectangle(cr, c * cell_w, (turbo_tables + q) * cell_h, cell_w + 0.5, cell_h + 0.5);
+            cairo_fill(cr);
+        }
+    }
+    return FALSE;
+}
+
+// Turbo window: aggregate view only, individual customers would be unreadable
+void create_turbo_ui() {
+    window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(window), "Sweet Harmony Bakery - Turbo");
+    gtk_window_set_default_size(GTK_WINDOW(window), 900, 600);
+    gtk_container_set_border_width(GTK_CONTAINER(window), 10);
+    g_signal_connect(window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
+    
+    setup_css();
+    
+    GtkWidget *main_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
+    gtk_container_add(GTK_CONTAINER(window), main_box);
+    
+    char title[128];
+    if (turbo_speed > 0) {
+        snprintf(title, sizeof(title), "%d tables at %.0fx speed", turbo_tables, turbo_speed);
+    } else {
+        snprintf(title, sizeof(title), "%d tables, unthrottled", turbo_tables);
+    }
+    GtkWidget *title_label = gtk_label_new(title);
+    apply_css(title_label, "header-label");
+    gtk_box_pack_start(GTK_BOX(main_box), title_label, FALSE, FALSE, 5);
+    
+    turbo_label = gtk_label_new("Starting...");
+    apply_css(turbo_label, "status-label");
+    gtk_box_pack_start(GTK_BOX(main_box), turbo_label, FALSE, FALSE, 5);
+    
+    heat_area = gtk_drawing_area_new();
+    g_signal_connect(heat_area, "draw", G_CALLBACK(on_heat_draw), NULL);
+    gtk_box_pack_start(GTK_BOX(main_box), heat_area, TRUE, TRUE, 5);
+    
+    GtkWidget *legend = gtk_label_new("Rows: tables (red / blue / empty), then red and blue queue pressure. Time runs left to right.");
+    gtk_box_pack_start(GTK_BOX(main_box), legend, FALSE, FALSE, 5);
+    
+    GtkWidget *exit_button = gtk_button_new_with_label("Exit");
+    g_signal_connect(exit_button, "clicked", G_CALLBACK(gtk_main_quit), NULL);
+    gtk_box_pack_start(GTK_BOX(main_box), exit_button, FALSE, FALSE, 5);
+    
+    gtk_widget_show_all(window);
+}
+
+// Parse the turbo options (GTK has already consumed its own); false on bad usage
+bool turbo_parse_args(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char *val = i + 1 < argc ? argv[i + 1] : "0";
+        if (strcmp(argv[i], "--turbo") == 0) {
+            turbo_speed = atof(val);
+            i++;
+        } else if (strcmp(argv[i], "--tables") == 0) {
+            turbo_tables = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--arrival-ms") == 0) {
+            turbo_arrival_ms = atof(val);
+            i++;
+        } else {
+            fprintf(stderr, "Usage: %s [--turbo SPEED (0 = unthrottled)] [--tables N] [--arrival-ms MS]\n", argv[0]);
+            return false;
+        }
+    }
+    if (turbo_tables < 1 || turbo_tables > MAX_TURBO_TABLES || turbo_arrival_ms <= 0) {
+        fprintf(stderr, "--tables must be 1..%d and --arrival-ms positive.\n", MAX_TURBO_TABLES);
+        return false;
+    }
+    return true;
+}
+
+// Headless engine at full or accelerated speed; the UI only samples it. Needs sim_seed set
+int turbo_run(void) {
+    pthread_t engine;
+    atomic_store(&turbo_running, true);
+    pthread_create(&engine, NULL, turbo_engine, NULL);
+    
+    // Table rows start empty (-1, since RED is 0); queue rows start at zero pressure
+    memset(heat, -1, sizeof(heat));
+    for (int c = 0; c < HEAT_COLUMNS; c++) {
+        heat[c][turbo_tables] = 0;
+        heat[c][turbo_tables + 1] = 0;
+    }
+    create_turbo_ui();
+    g_timeout_add(TURBO_FRAME_MS, turbo_frame, NULL);
+    gtk_main();
+    
+    atomic_store(&turbo_running, false);
+    pthread_join(engine, NULL);
+    return 0;
+}
+
+// Turbo rules: an arrival that may not enter balks at a long line of its color, as in
+// customer_thread(); a color may enter while it is not ahead. Reneging is not modelled
+static bool turbo_joins(const TurboSnapshot *state, CustomerColor color, RngStream *rng) {
+    int own = color == RED ? state->red_inside : state->blue_inside;
+    int other = color == RED ? state->blue_inside : state->red_inside;
+    long waiting = color == RED ? state->red_waiting : state->blue_waiting;
+    int balk_at = BALK_MIN + (int)(rng_next(rng) % (BALK_MAX - BALK_MIN + 1));
+    return own <= other || waiting < balk_at;
+}
+
+static int turbo_admit(const TurboSnapshot *state) {
+    if (state->red_waiting > 0 && state->red_inside <= state->blue_inside) {
+        return RED;
+    }
+    if (state->blue_waiting > 0 && state->blue_inside <= state->red_inside) {
+        return BLUE;
+    }
+    return -1;
+}
+
 int main(int argc, char *argv[]) {
+    gtk_init(&argc, &argv);
+    
+    // Turbo options (GTK has already consumed its own); turbo mode asks nothing
+    if (!turbo_parse_args(argc, argv)) {
+        return 1;
+    }
+    if (turbo_speed >= 0) {
+        sim_seed = choose_seed();
+        return turbo_run();
+    }
+    
     printf("Enter number of tables: ");
     scanf("%d", &NUM_TABLES);
     
-    printf("Enter maximum number of customers: ");
+    printf("Enter initial customer capacity: ");
     scanf("%d", &MAX_CUSTOMERS);
     
-    gtk_init(&argc, &argv);
-    
-    // Allocate memory for customers array
-    customers = (Customer*)malloc(MAX_CUSTOMERS * sizeof(Customer));
-    for (int i = 0; i < MAX_CUSTOMERS; i++) {
-        customers[i].id = i;
-        customers[i].in_bakery = false;
-        customers[i].table_num = -1;
-        customers[i].widget = NULL;
-    }
+    // Preallocate customer slots; more chunks are added if the bakery gets busier
+    slot_pool_init(MAX_CUSTOMERS);
     
     sem_init(&tables_sem, 0, NUM_TABLES);
-    srand(time(NULL));
+    table_owner = g_new(int, NUM_TABLES);
+    for (int i = 0; i < NUM_TABLES; i++) {
+        table_owner[i] = -1;
+    }
+    sim_seed = choose_seed();
     
     create_ui();
     g_timeout_add(500, update_ui, NULL);
+    g_timeout_add(LOG_REFRESH_MS, refresh_log, NULL);
     g_timeout_add_seconds(1, check_customers, NULL);
     
     log_activity("Bakery simulation started");
@@ -478,8 +1296,10 @@ int main(int argc, char *argv[]) {
     // Cleanup
     sem_destroy(&tables_sem);
     pthread_mutex_destroy(&mutex);
-    free(customers);
+    slot_pool_destroy();
+    free(expiry_heap);
     g_free(table_widgets);
+    g_free(table_owner);
     
     return 0;
 }
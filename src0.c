@@ -1,88 +1,278 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <sched.h>
+#include <time.h>
 #include <unistd.h>
 
 #define TABLES 3
 #define CUSTOMERS 10
 
-sem_t red_light, blue_light;  // Traffic lights for outfits
+// Rendezvous: the k-th red and the k-th blue arrival meet in slot k % SLOTS
+#define SLOT_BITS 12
+#define SLOTS (1 << SLOT_BITS)
+#define SPIN_LIMIT 2000       // Spins before a waiter sleeps on its semaphore
+
+// A table shared by one red-blue pair; the last of the two to leave frees it
+typedef struct
+{
+    atomic_int diners;
+} PairTable;
+
+// One arrival waiting to be paired
+typedef struct
+{
+    long id;
+    int is_red;
+    atomic_int paired;
+    long partner;             // Id of the customer we were paired with
+    PairTable* table;         // Reserved for the pair before either is released
+    sem_t wake;
+} Waiter;
+
+// Exchanger slot; state is round * 4 + (1 if red arrived) + (2 if blue arrived)
+typedef struct
+{
+    _Alignas(64) atomic_ulong state;
+    Waiter* waiter[2];        // [0] blue, [1] red
+} Slot;
+
+Slot slots[SLOTS];
+atomic_ulong red_tickets, blue_tickets;
 sem_t available_tables;       // Counting available tables
-pthread_mutex_t lock;         // For safe counting
 
-int reds = 0, blues = 0;      // Current customers by color
+// Pair this arrival with one of the opposite color; returns the partner's id.
+// With tables, the arrival that completes the pair also takes a table for both
+// before releasing its partner, so the pair is admitted and seated together.
+long rendezvous(Waiter* me, sem_t* tables)
+{
+    atomic_ulong* tickets = me->is_red ? &red_tickets : &blue_tickets;
+    unsigned long ticket = atomic_fetch_add(tickets, 1);
+    Slot* slot = &slots[ticket & (SLOTS - 1)];
+    unsigned long round = ticket >> SLOT_BITS;
+    unsigned long mine = me->is_red ? 1 : 2;
+
+    // The slot is still serving an earlier round only if one color is SLOTS ahead
+    for (int spins = 0; atomic_load(&slot->state) >> 2 != round; spins++)
+    {
+        if (spins < SPIN_LIMIT) sched_yield(); else usleep(100);
+    }
+
+    slot->waiter[me->is_red] = me;
+    unsigned long before = atomic_fetch_or(&slot->state, mine);
+
+    if (before & (3 - mine))
+    {
+        // Second to arrive: complete the pair and hand the slot to the next round
+        Waiter* other = slot->waiter[!me->is_red];
+        me->partner = other->id;
+        other->partner = me->id;
+        atomic_store(&slot->state, (round + 1) << 2);
+        if (tables != NULL)
+        {
+            sem_wait(tables);
+            PairTable* table = malloc(sizeof(PairTable));
+            if (table == NULL)
+            {
+                perror("Error allocating pair table");
+                exit(1);
+            }
+            atomic_init(&table->diners, 2);
+            me->table = other->table = table;
+        }
+        atomic_store(&other->paired, 1);
+        sem_post(&other->wake);
+        return me->partner;
+    }
+
+    // First to arrive: spin briefly, then sleep until the partner shows up
+    for (int spins = 0; spins < SPIN_LIMIT && !atomic_load(&me->paired); spins++)
+    {
+        sched_yield();
+    }
+    sem_wait(&me->wake);
+    return me->partner;
+}
 
-void* customer(void* arg) 
+void* customer(void* arg)
 {
     int id = *(int*)arg;
-    int is_red = id % 2;      // Even IDs are red, odd are blue
-    
+    int is_red = id % 2 == 0; // Even IDs are red, odd are blue
+    Waiter me = { .id = id, .is_red = is_red };
+    sem_init(&me.wake, 0, 0);
+
     printf("Customer %d (%s) arrives\n", id, is_red ? "RED" : "BLUE");
-    
-    // Wait for matching customer
-    if (is_red) 
-    {
-        sem_wait(&blue_light); // Need a blue to balance
-        reds++;
-        sem_post(&red_light);  // Signal red is available
-    } else {
-        sem_wait(&red_light);  // Need a red to balance
-        blues++;
-        sem_post(&blue_light); // Signal blue is available
-    }
-    
-    // Get a table
-    sem_wait(&available_tables);
-    printf("Customer %d (%s) sits down\n", id, is_red ? "RED" : "BLUE");
-    
+
+    // Wait for a customer of the other color; the pair is admitted and seated together
+    long partner = rendezvous(&me, &available_tables);
+    printf("Customer %d (%s) sits down with customer %ld\n", id, is_red ? "RED" : "BLUE", partner);
+
     // Enjoy pastry
     sleep(1 + id % 3);
-    
-    // Leave table
-    sem_post(&available_tables);
+
+    // Leave table; it is free again once both partners are gone
     printf("Customer %d (%s) leaves\n", id, is_red ? "RED" : "BLUE");
-    
-    // Update counts
-    pthread_mutex_lock(&lock);
-    if (is_red) reds--; else blues--;
-    pthread_mutex_unlock(&lock);
-    
-    // Allow new pairs
-    if (is_red) sem_post(&blue_light); else sem_post(&red_light);
-    
+    if (atomic_fetch_sub(&me.table->diners, 1) == 1)
+    {
+        free(me.table);
+        sem_post(&available_tables);
+    }
+
+    sem_destroy(&me.wake);
     return NULL;
 }
 
-int main() 
+// Stress test: many threads pair as fast as they can; every pair is checked
+typedef struct
 {
+    int thread;
+    int is_red;
+    long rounds;
+} StressArg;
+
+atomic_long pairs_done, red_partner_sum, blue_partner_sum, red_id_sum, blue_id_sum;
+
+void* stress_worker(void* arg)
+{
+    StressArg* s = (StressArg*)arg;
+    Waiter me;
+    sem_init(&me.wake, 0, 0);
+
+    for (long r = 0; r < s->rounds; r++)
+    {
+        me.id = ((long)s->thread << 32) | r;
+        me.is_red = s->is_red;
+        atomic_store(&me.paired, 0);
+        long partner = rendezvous(&me, NULL);
+
+        if (s->is_red)
+        {
+            atomic_fetch_add(&red_id_sum, me.id);
+            atomic_fetch_add(&red_partner_sum, partner);
+            atomic_fetch_add(&pairs_done, 1);
+        }
+        else
+        {
+            atomic_fetch_add(&blue_id_sum, me.id);
+            atomic_fetch_add(&blue_partner_sum, partner);
+        }
+        // Partners are always of the other color: reds run on even threads
+        if (((partner >> 32) % 2 == 0) == s->is_red)
+        {
+            fprintf(stderr, "Customer %ld paired with same-color %ld\n", me.id, partner);
+            exit(1);
+        }
+    }
+    sem_destroy(&me.wake);
+    return NULL;
+}
+
+static double wall_clock()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Run one stress round; returns 0 if every pair was formed exactly once, exits on deadlock
+int stress(int threads, long rounds)
+{
+    pthread_t tids[threads];
+    StressArg args[threads];
+
+    memset(slots, 0, sizeof(slots));
+    atomic_store(&red_tickets, 0);
+    atomic_store(&blue_tickets, 0);
+    atomic_store(&pairs_done, 0);
+    atomic_store(&red_partner_sum, 0);
+    atomic_store(&blue_partner_sum, 0);
+    atomic_store(&red_id_sum, 0);
+    atomic_store(&blue_id_sum, 0);
+
+    double start = wall_clock();
+    for (int i = 0; i < threads; i++)
+    {
+        args[i] = (StressArg){ i, i % 2 == 0, rounds };
+        pthread_create(&tids[i], NULL, stress_worker, &args[i]);
+    }
+
+    // Watchdog: no new pair for 5 seconds means the pairing deadlocked
+    long expected = threads / 2 * rounds;
+    long last = -1;
+    double last_progress = wall_clock();
+    while (atomic_load(&pairs_done) < expected)
+    {
+        usleep(10000);
+        long now = atomic_load(&pairs_done);
+        if (now != last)
+        {
+            last = now;
+            last_progress = wall_clock();
+        }
+        else if (wall_clock() - last_progress > 5.0)
+        {
+            // The stuck threads still use the slots, so no later round can reuse them
+            printf("%3d threads: DEADLOCK after %ld of %ld pairs, aborting\n", threads, now, expected);
+            fflush(stdout);
+            exit(1);
+        }
+    }
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(tids[i], NULL);
+    }
+    double secs = wall_clock() - start;
+
+    // Each red saw exactly the blues, and each blue exactly the reds
+    int ok = atomic_load(&red_partner_sum) == atomic_load(&blue_id_sum) &&
+             atomic_load(&blue_partner_sum) == atomic_load(&red_id_sum) &&
+             atomic_load(&pairs_done) == expected;
+    printf("%3d threads: %ld pairs in %.2f s (%.2f M pairs/s) %s\n", threads, expected, secs,
+           expected / secs / 1e6, ok ? "ok" : "LOST OR DUPLICATED PAIRS");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--stress") == 0)
+    {
+        // ./src0 --stress [MAX_THREADS] [PAIRS_PER_THREAD]
+        int max_threads = argc > 2 ? atoi(argv[2]) : 16;
+        long rounds = argc > 3 ? atol(argv[3]) : 200000;
+        int failed = 0;
+        for (int threads = 2; threads <= max_threads; threads *= 2)
+        {
+            failed |= stress(threads, rounds);
+        }
+        return failed;
+    }
+
     pthread_t threads[CUSTOMERS];
     int ids[CUSTOMERS];
-    
+
     // Initialize semaphores
-    sem_init(&red_light, 0, 0);
-    sem_init(&blue_light, 0, 0);
     sem_init(&available_tables, 0, TABLES);
-    pthread_mutex_init(&lock, NULL);
-    
+
     // Create customers
-    for (int i = 0; i < CUSTOMERS; i++) 
+    for (int i = 0; i < CUSTOMERS; i++)
     {
         ids[i] = i;
         pthread_create(&threads[i], NULL, customer, &ids[i]);
         sleep(1); // Space out arrivals
     }
-    
+
     // Wait for all customers
-    for (int i = 0; i < CUSTOMERS; i++) 
+    for (int i = 0; i < CUSTOMERS; i++)
     {
         pthread_join(threads[i], NULL);
     }
-    
+
     // Clean up
-    sem_destroy(&red_light);
-    sem_destroy(&blue_light);
     sem_destroy(&available_tables);
-    pthread_mutex_destroy(&lock);
-    
+
     return 0;
 }
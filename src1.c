@@ -1,24 +1,49 @@
 #include <stdio.h>
+#include <stdatomic.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <sched.h>
 #include <unistd.h>
 
 #define N 3
 #define M 6
+#define S 64
 
-sem_t r,b,t;
-pthread_mutex_t m;
-int x,y;
+typedef struct { int i; long o; sem_t w; } W;
+typedef struct { _Alignas(64) atomic_ulong s; W* w[2]; } X;
+
+X q[S];
+atomic_ulong k[2];
+sem_t t;
+atomic_int x,y;
+
+/* k-th red meets k-th blue in q[k%S]; s = round*4 | red 1 | blue 2 */
+long g(W* w, int c)
+{
+    unsigned long n = atomic_fetch_add(&k[c],1), h = n/S, z = 1<<c;
+    X* e = &q[n%S];
+    while(atomic_load(&e->s)>>2 != h) sched_yield();
+    e->w[c] = w;
+    if(atomic_fetch_or(&e->s,z) & (3^z)) {
+        W* o = e->w[!c];
+        w->o = o->i; o->o = w->i;
+        atomic_store(&e->s,(h+1)<<2);
+        sem_post(&o->w);
+    } else sem_wait(&w->w);
+    return w->o;
+}
 
 void* f(void* a) 
 {
     int i = *(int*)a;
     int c = i%2;
+    W w = { .i = i };
+    sem_init(&w.w,0,0);
     
     printf("%d (%s) came\n",i,c?"BLUE":"RED");
     
-    if(c) { sem_wait(&r); y++; sem_post(&b); }
-    else  { sem_wait(&b); x++; sem_post(&r); }
+    printf("%d (%s) pairs with %ld\n",i,c?"BLUE":"RED",g(&w,c));
+    atomic_fetch_add(c?&y:&x,1);
     
     sem_wait(&t);
     printf("%d (%s) sits\n",i,c?"BLUE":"RED");
@@ -26,12 +51,9 @@ void* f(void* a)
     sem_post(&t);
     printf("%d (%s) left\n",i,c?"BLUE":"RED");
     
-    pthread_mutex_lock(&m);
-    if(c) y--; else x--;
-    pthread_mutex_unlock(&m);
-    
-    if(c) sem_post(&r); else sem_post(&b);
+    atomic_fetch_sub(c?&y:&x,1);
     
+    sem_destroy(&w.w);
     return NULL;
 }
 
@@ -39,10 +61,7 @@ int main() {
     pthread_t p[M];
     int a[M];
     
-    sem_init(&r,0,0);
-    sem_init(&b,0,0);
     sem_init(&t,0,N);
-    pthread_mutex_init(&m,NULL);
     
     for(int i=0;i<M;i++) {
         a[i]=i;
@@ -52,10 +71,7 @@ int main() {
     
     for(int i=0;i<M;i++) pthread_join(p[i],NULL);
     
-    sem_destroy(&r);
-    sem_destroy(&b);
     sem_destroy(&t);
-    pthread_mutex_destroy(&m);
     
     return 0;
 }
@@ -5,20 +5,31 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
 #include <time.h>
 
 // Configuration will be set by user input
 int NUM_TABLES;
-int MAX_CUSTOMERS;
+int MAX_CUSTOMERS;  // Slots preallocated at startup; the table grows past it on demand
 
 typedef enum { RED, BLUE } CustomerColor;
 
+// Counter-based RNG stream: the n-th draw is a pure function of (key, n)
+typedef struct {
+    uint64_t key;
+    uint64_t counter;
+} RngStream;
+
 typedef struct {
     int id;
     CustomerColor color;
     bool in_bakery;
     int table_num;
     GtkWidget *widget;
+    RngStream rng;  // Private random stream for this visit
+    _Atomic uint32_t next_free;  // Free-stack link (id + 1, 0 ends the stack)
 } Customer;
 
 // Global Variables
@@ -28,9 +39,118 @@ pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 int red_count = 0;
 int blue_count = 0;
 int tables_used = 0;
+int *table_owner;  // Customer id seated at each table, -1 if free; protected by mutex
 bool running = true;
+uint64_t sim_seed;
+atomic_long spawn_count = 0;  // Stream number for the next customer
+
+// Set up a fresh slot; called once per slot when its chunk is allocated
+static void slot_setup(Customer *slot) {
+    slot->in_bakery = false;
+    slot->table_num = -1;
+    slot->widget = NULL;
+}
+
+// Tear down a slot when its chunk is freed at shutdown
+static void slot_teardown(Customer *slot) {
+    (void)slot;  // Nothing to release
+}
+
+// Customer slots live in fixed-size chunks, so growing the table never moves a
+// customer that a running thread points at. Free slots form a lock-free stack
+// whose head carries a generation tag, which makes slot reuse ABA-safe.
+// This block is identical in demo_gui1.c, src_GUI01.c and src_GUI2.c; what
+// differs per file lives in slot_setup() and slot_teardown() above it.
+#define SLOT_CHUNK 64
+#define MAX_SLOT_CHUNKS 4096
+
+Customer *slot_chunks[MAX_SLOT_CHUNKS];
+atomic_int slot_capacity = 0;
+_Atomic uint64_t free_slots = 0;  // (tag << 32) | (top id + 1); low half 0 means empty
+pthread_mutex_t grow_mutex = PTHREAD_MUTEX_INITIALIZER;  // Serialises chunk allocation only
+
+Customer *customer_at(int id) {
+    return &slot_chunks[id / SLOT_CHUNK][id % SLOT_CHUNK];
+}
 
-Customer *customers;
+// Return a slot to the free stack
+void slot_free(int id) {
+    Customer *slot = customer_at(id);
+    uint64_t head = atomic_load(&free_slots);
+    uint64_t next;
+    do {
+        atomic_store_explicit(&slot->next_free, (uint32_t)head, memory_order_relaxed);
+        next = (((head >> 32) + 1) << 32) | (uint32_t)(id + 1);
+    } while (!atomic_compare_exchange_weak(&free_slots, &head, next));
+}
+
+// Pop a free slot; -1 if the stack is empty
+static int slot_pop(void) {
+    uint64_t head = atomic_load(&free_slots);
+    uint64_t next;
+    do {
+        uint32_t top = (uint32_t)head;
+        if (top == 0) {
+            return -1;
+        }
+        uint32_t below = atomic_load_explicit(&customer_at(top - 1)->next_free, memory_order_relaxed);
+        next = (((head >> 32) + 1) << 32) | below;
+    } while (!atomic_compare_exchange_weak(&free_slots, &head, next));
+    return (int)(uint32_t)head - 1;
+}
+
+// Add a chunk of fresh slots; false once MAX_SLOT_CHUNKS is reached
+static bool slot_grow(void) {
+    pthread_mutex_lock(&grow_mutex);
+    int base = atomic_load(&slot_capacity);
+    if (base / SLOT_CHUNK >= MAX_SLOT_CHUNKS) {
+        pthread_mutex_unlock(&grow_mutex);
+        return false;
+    }
+    Customer *chunk = (Customer*)calloc(SLOT_CHUNK, sizeof(Customer));
+    for (int j = 0; j < SLOT_CHUNK; j++) {
+        chunk[j].id = base + j;
+        slot_setup(&chunk[j]);
+    }
+    slot_chunks[base / SLOT_CHUNK] = chunk;
+    atomic_store(&slot_capacity, base + SLOT_CHUNK);
+    pthread_mutex_unlock(&grow_mutex);
+    
+    for (int j = SLOT_CHUNK - 1; j >= 0; j--) {
+        slot_free(base + j);
+    }
+    return true;
+}
+
+// Claim a customer slot in O(1), growing the table when it runs dry
+int slot_alloc(void) {
+    for (;;) {
+        int id = slot_pop();
+        if (id >= 0) {
+            return id;
+        }
+        if (!slot_grow()) {
+            return -1;
+        }
+    }
+}
+
+// Preallocate the slots requested at startup
+void slot_pool_init(int initial) {
+    while (atomic_load(&slot_capacity) < initial && slot_grow()) {
+    }
+}
+
+// Release every chunk at shutdown
+void slot_pool_destroy(void) {
+    int chunks = atomic_load(&slot_capacity) / SLOT_CHUNK;
+    for (int c = 0; c < chunks; c++) {
+        for (int j = 0; j < SLOT_CHUNK; j++) {
+            slot_teardown(&slot_chunks[c][j]);
+        }
+        free(slot_chunks[c]);
+    }
+}
 
 // GTK Widgets
 GtkWidget *window;
@@ -48,6 +168,32 @@ void create_customer(CustomerColor color);
 void create_ui(void);
 gboolean update_ui(gpointer data);
 
+// SplitMix64 finalizer: a strong 64-bit bijective mix
+uint64_t rng_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Derive an independent stream from a seed and a stream number
+RngStream rng_stream(uint64_t seed, uint64_t stream_id) {
+    RngStream stream = { rng_mix(seed ^ rng_mix(stream_id + 0x9E3779B97F4A7C15ULL)), 0 };
+    return stream;
+}
+
+// Next 64-bit draw; streams share no state, so threads never contend
+uint64_t rng_next(RngStream *stream) {
+    return rng_mix(stream->key + ++stream->counter * 0x9E3779B97F4A7C15ULL);
+}
+
+// Seed from BAKERY_SEED, or from the clock (printed so the run can be replayed)
+uint64_t choose_seed() {
+    const char *seed_env = getenv("BAKERY_SEED");
+    uint64_t seed = seed_env ? strtoull(seed_env, NULL, 10) : (uint64_t)time(NULL);
+    printf("Seed: %llu (set BAKERY_SEED to replay)\n", (unsigned long long)seed);
+    return seed;
+}
+
 // Callback functions
 void on_add_red_clicked(GtkWidget *widget, gpointer data) {
     create_customer(RED);
@@ -107,13 +253,9 @@ void setup_css() {
     );
 }
 
+// O(1): seating and leaving keep table_owner up to date
 bool is_table_occupied(int table_num) {
-    for (int i = 0; i < MAX_CUSTOMERS; i++) {
-        if (customers[i].in_bakery && customers[i].table_num == table_num) {
-            return true;
-        }
-    }
-    return false;
+    return table_owner[table_num] >= 0;
 }
 void create_customer_widget(Customer *customer) {
     char label_text[10];
@@ -161,6 +303,7 @@ void remove_customer(Customer *customer) {
     
     if (customer->table_num >= 0) {
         tables_used--;
+        table_owner[customer->table_num] = -1;
         customer->table_num = -1;
     }
     
@@ -186,6 +329,7 @@ void *customer_thread(void *arg) {
         if (!is_table_occupied(i)) {
             customer->table_num = i;
             customer->in_bakery = true;
+            table_owner[i] = customer->id;
             tables_used++;
             move_to_table(customer);
             break;
@@ -193,36 +337,31 @@ void *customer_thread(void *arg) {
     }
     pthread_mutex_unlock(&mutex);
     
-    sleep(3 + (rand() % 5));
+    sleep(3 + (int)(rng_next(&customer->rng) % 5));
     
     pthread_mutex_lock(&mutex);
     remove_customer(customer);
     pthread_mutex_unlock(&mutex);
     
     sem_post(&tables_sem);
+    slot_free(customer->id);
     return NULL;
 }
 
 void create_customer(CustomerColor color) {
     pthread_t thread;
-    int id = -1;
-    
-    pthread_mutex_lock(&mutex);
-    for (int i = 0; i < MAX_CUSTOMERS; i++) {
-        if (!customers[i].in_bakery && customers[i].widget == NULL) {
-            id = i;
-            break;
-        }
+    int id = slot_alloc();  // Lock-free; the new slot is ours alone until the thread starts
+    if (id == -1) {
+        return;
     }
     
-    if (id != -1) {
-        customers[id].color = color;
-        customers[id].in_bakery = false;
-        customers[id].table_num = -1;
-        pthread_create(&thread, NULL, customer_thread, &customers[id]);
-        pthread_detach(thread);
-    }
-    pthread_mutex_unlock(&mutex);
+    Customer *customer = customer_at(id);
+    customer->color = color;
+    customer->in_bakery = false;
+    customer->table_num = -1;
+    customer->rng = rng_stream(sim_seed, atomic_fetch_add(&spawn_count, 1));
+    pthread_create(&thread, NULL, customer_thread, customer);
+    pthread_detach(thread);
 }
 void create_ui() {
     window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
@@ -323,26 +462,418 @@ gboolean update_ui(gpointer data) {
     return G_SOURCE_CONTINUE;
 }
 
+// Turbo stays match the threaded customers (3-7 s)
+#define TURBO_STAY_MIN 3
+#define TURBO_STAY_MAX 7
+
+// Turbo mode (--turbo SPEED): headless engine in virtual time, sampled by the UI.
+// This block is identical in demo_gui1.c, src_GUI01.c and src_GUI2.c; each file
+// defines TURBO_STAY_MIN/MAX above it and turbo_joins()/turbo_admit() below it.
+#define MAX_TURBO_TABLES 1024
+#define TURBO_FRAME_MS 33        // Display samples the engine at ~30 fps
+#define TURBO_PUBLISH_EVENTS 4096  // Engine publishes a snapshot at least this often
+#define HEAT_COLUMNS 240         // Frames of history shown in the heat-map
+
+// Turbo engine state, owned by the engine thread
+typedef struct {
+    double time;                 // Virtual seconds
+    int table;
+} TurboDeparture;
+
+// What the display sees of the turbo engine; published under a seqlock
+typedef struct {
+    double virtual_time;
+    double events_per_second;    // Engine rate over the last publish interval
+    long arrivals;
+    long served;
+    long walked_away;            // Arrivals that turbo_joins() turned away
+    int red_inside;
+    int blue_inside;
+    long red_waiting;
+    long blue_waiting;
+    int8_t table_color[MAX_TURBO_TABLES];  // -1 empty, else CustomerColor
+} TurboSnapshot;
+
+int turbo_tables = 64;
+double turbo_speed = -1;         // Virtual seconds per real second; 0 = unthrottled, <0 = off
+double turbo_arrival_ms = 50;    // Mean virtual time between arrivals
+atomic_bool turbo_running;
+atomic_uint snapshot_seq;        // Odd while the engine is writing
+TurboSnapshot snapshot;
+TurboSnapshot frame;             // Last snapshot read by the GTK thread
+int8_t heat[HEAT_COLUMNS][MAX_TURBO_TABLES + 2];  // History; last two rows are queue pressure
+int heat_head = 0;
+GtkWidget *heat_area;
+GtkWidget *turbo_label;
+
+// Per-file rules: whether an arrival joins the line, and which color to seat next (-1: none)
+static bool turbo_joins(const TurboSnapshot *state, CustomerColor color, RngStream *rng);
+static int turbo_admit(const TurboSnapshot *state);
+
+// Seqlock writer: readers retry instead of ever blocking the engine
+static void publish_snapshot(const TurboSnapshot *state) {
+    atomic_fetch_add_explicit(&snapshot_seq, 1, memory_order_acq_rel);
+    atomic_thread_fence(memory_order_release);
+    snapshot = *state;
+    atomic_fetch_add_explicit(&snapshot_seq, 1, memory_order_release);
+}
+
+// Seqlock reader (GTK thread); false if the engine kept it busy
+static bool read_snapshot(TurboSnapshot *out) {
+    for (int attempt = 0; attempt < 100; attempt++) {
+        unsigned before = atomic_load_explicit(&snapshot_seq, memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        *out = snapshot;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&snapshot_seq, memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double rng_unit(RngStream *stream) {
+    return (rng_next(stream) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Departure min-heap helpers (engine thread only)
+static void departure_push(TurboDeparture *heap, int *size, TurboDeparture d) {
+    int pos = (*size)++;
+    while (pos > 0 && heap[(pos - 1) / 2].time > d.time) {
+        heap[pos] = heap[(pos - 1) / 2];
+        pos = (pos - 1) / 2;
+    }
+    heap[pos] = d;
+}
+
+static TurboDeparture departure_pop(TurboDeparture *heap, int *size) {
+    TurboDeparture top = heap[0];
+    TurboDeparture last = heap[--(*size)];
+    int pos = 0;
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= *size) {
+            break;
+        }
+        if (child + 1 < *size && heap[child + 1].time < heap[child].time) {
+            child++;
+        }
+        if (last.time <= heap[child].time) {
+            break;
+        }
+        heap[pos] = heap[child];
+        pos = child;
+    }
+    heap[pos] = last;
+    return top;
+}
+
+// Engine thread: this file's rules (turbo_joins, turbo_admit), run as discrete events in virtual time
+void *turbo_engine(void *arg) {
+    TurboSnapshot state = { 0 };
+    TurboDeparture *departures = g_new(TurboDeparture, turbo_tables);
+    int *free_tables = g_new(int, turbo_tables);
+    int departure_count = 0;
+    int free_count = turbo_tables;
+    RngStream arrivals_rng = rng_stream(sim_seed, 1);
+    RngStream stay_rng = rng_stream(sim_seed, 2);
+    RngStream color_rng = rng_stream(sim_seed, 3);
+    RngStream join_rng = rng_stream(sim_seed, 4);
+    
+    for (int i = 0; i < turbo_tables; i++) {
+        state.table_color[i] = -1;
+        free_tables[i] = turbo_tables - 1 - i;
+    }
+    
+    double next_arrival = 0;
+    double real_start = monotonic_seconds();
+    double last_publish = real_start;
+    long events = 0;
+    long events_at_publish = 0;
+    
+    while (atomic_load_explicit(&turbo_running, memory_order_relaxed)) {
+        // Next event: the earlier of the next arrival and the next departure
+        if (departure_count > 0 && departures[0].time <= next_arrival) {
+            TurboDeparture d = departure_pop(departures, &departure_count);
+            state.virtual_time = d.time;
+            if (state.table_color[d.table] == RED) {
+                state.red_inside--;
+            } else {
+                state.blue_inside--;
+            }
+            state.table_color[d.table] = -1;
+            free_tables[free_count++] = d.table;
+            state.served++;
+        } else {
+            state.virtual_time = next_arrival;
+            CustomerColor color = (rng_next(&color_rng) >> 63) ? BLUE : RED;
+            if (!turbo_joins(&state, color, &join_rng)) {
+                state.walked_away++;
+            } else if (color == BLUE) {
+                state.blue_waiting++;
+            } else {
+                state.red_waiting++;
+            }
+            state.arrivals++;
+            next_arrival += rng_unit(&arrivals_rng) * 2 * turbo_arrival_ms / 1000.0;
+        }
+        events++;
+        
+        // Admission: seat whoever this file's rule lets in while tables are free
+        while (free_count > 0) {
+            int color = turbo_admit(&state);
+            if (color == RED) {
+                state.red_waiting--;
+                state.red_inside++;
+            } else if (color == BLUE) {
+                state.blue_waiting--;
+                state.blue_inside++;
+            } else {
+                break;
+            }
+            int table = free_tables[--free_count];
+            state.table_color[table] = color;
+            double stay = TURBO_STAY_MIN + rng_unit(&stay_rng) * (TURBO_STAY_MAX - TURBO_STAY_MIN);
+            TurboDeparture d = { state.virtual_time + stay, table };
+            departure_push(departures, &departure_count, d);
+        }
+        
+        // Pace virtual time against the wall clock when a speed is set
+        double ahead = 0;
+        if (turbo_speed > 0) {
+            ahead = state.virtual_time / turbo_speed - (monotonic_seconds() - real_start);
+        }
+        if (ahead > 0 || events - events_at_publish >= TURBO_PUBLISH_EVENTS) {
+            double now = monotonic_seconds();
+            if (now > last_publish) {
+                state.events_per_second = (events - events_at_publish) / (now - last_publish);
+            }
+            publish_snapshot(&state);
+            last_publish = now;
+            events_at_publish = events;
+        }
+        if (ahead > 0) {
+            usleep(ahead > 0.005 ? 5000 : (useconds_t)(ahead * 1e6));
+        }
+    }
+    
+    g_free(departures);
+    g_free(free_tables);
+    return NULL;
+}
+
+// Pressure of a queue as a 0..100 shade, log-scaled so long queues stay distinguishable
+static int8_t queue_shade(long waiting) {
+    int shade = 0;
+    while (waiting > 0 && shade < 100) {
+        waiting >>= 1;
+        shade += 6;
+    }
+    return shade > 100 ? 100 : shade;
+}
+
+// Frame tick: sample the latest snapshot, push one heat-map column, update labels
+gboolean turbo_frame(gpointer data) {
+    if (!read_snapshot(&frame)) {
+        return G_SOURCE_CONTINUE;  // Try again next frame
+    }
+    
+    int8_t *column = heat[heat_head];
+    for (int t = 0; t < turbo_tables; t++) {
+        column[t] = frame.table_color[t];
+    }
+    column[turbo_tables] = queue_shade(frame.red_waiting);
+    column[turbo_tables + 1] = queue_shade(frame.blue_waiting);
+    heat_head = (heat_head + 1) % HEAT_COLUMNS;
+    
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "t = %.0f s virtual | %.2f M events/s | arrived %ld, served %ld, walked away %ld | "
+             "inside %d red / %d blue | waiting %ld red / %ld blue",
+             frame.virtual_time, frame.events_per_second / 1e6, frame.arrivals, frame.served,
+             frame.walked_away, frame.red_inside, frame.blue_inside, frame.red_waiting, frame.blue_waiting);
+    gtk_label_set_text(GTK_LABEL(turbo_label), buffer);
+    gtk_widget_queue_draw(heat_area);
+    return G_SOURCE_CONTINUE;
+}
+
+// Heat-map: one column per frame, one row per table, then red and blue queue pressure
+gboolean on_heat_draw(GtkWidget *widget, cairo_t *cr, gpointer data) {
+    int width = gtk_widget_get_allocated_width(widget);
+    int height = gtk_widget_get_allocated_height(widget);
+    int rows = turbo_tables + 2;
+    double cell_w = (double)width / HEAT_COLUMNS;
+    double cell_h = (double)height / rows;
+    
+    cairo_set_source_rgb(cr, 0.93, 0.93, 0.93);
+    cairo_paint(cr);
+    
+    for (int c = 0; c < HEAT_COLUMNS; c++) {
+        int8_t *column = heat[(heat_head + c) % HEAT_COLUMNS];  // Oldest on the left
+        for (int r = 0; r < turbo_tables; r++) {
+            if (column[r] < 0) {
+                continue;
+            }
+            if (column[r] == RED) {
+                cairo_set_source_rgb(cr, 0.9, 0.25, 0.25);
+            } else {
+                cairo_set_source_rgb(cr, 0.25, 0.35, 0.9);
+            }
+            cairo_rectangle(cr, c * cell_w, r * cell_h, cell_w + 0.5, cell_h + 0.5);
+            cairo_fill(cr);
+        }
+        for (int q = 0; q < 2; q++) {
+            double shade = column[turbo_tables + q] / 100.0;
+            if (q == 0) {
+                cairo_set_source_rgb(cr, 1.0, 1.0 - shade, 1.0 - shade);
+            } else {
+                cairo_set_source_rgb(cr, 1.0 - shade, 1.0 - shade, 1.0);
+            }
+            cairo_rectangle(cr, c * cell_w, (turbo_tables + q) * cell_h, cell_w + 0.5, cell_h + 0.5);
+            cairo_fill(cr);
+        }
+    }
+    return FALSE;
+}
+
+// Turbo window: aggregate view only, individual customers would be unreadable
+void create_turbo_ui() {
+    window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(window), "Sweet Harmony Bakery - Turbo");
+    gtk_window_set_default_size(GTK_WINDOW(window), 900, 600);
+    gtk_container_set_border_width(GTK_CONTAINER(window), 10);
+    g_signal_connect(window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
+    
+    setup_css();
+    
+    GtkWidget *main_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
+    gtk_container_add(GTK_CONTAINER(window), main_box);
+    
+    char title[128];
+    if (turbo_speed > 0) {
+        snprintf(title, sizeof(title), "%d tables at %.0fx speed", turbo_tables, turbo_speed);
+    } else {
+        snprintf(title, sizeof(title), "%d tables, unthrottled", turbo_tables);
+    }
+    GtkWidget *title_label = gtk_label_new(title);
+    apply_css(title_label, "header-label");
+    gtk_box_pack_start(GTK_BOX(main_box), title_label, FALSE, FALSE, 5);
+    
+    turbo_label = gtk_label_new("Starting...");
+    apply_css(turbo_label, "status-label");
+    gtk_box_pack_start(GTK_BOX(main_box), turbo_label, FALSE, FALSE, 5);
+    
+    heat_area = gtk_drawing_area_new();
+    g_signal_connect(heat_area, "draw", G_CALLBACK(on_heat_draw), NULL);
+    gtk_box_pack_start(GTK_BOX(main_box), heat_area, TRUE, TRUE, 5);
+    
+    GtkWidget *legend = gtk_label_new("Rows: tables (red / blue / empty), then red and blue queue pressure. Time runs left to right.");
+    gtk_box_pack_start(GTK_BOX(main_box), legend, FALSE, FALSE, 5);
+    
+    GtkWidget *exit_button = gtk_button_new_with_label("Exit");
+    g_signal_connect(exit_button, "clicked", G_CALLBACK(gtk_main_quit), NULL);
+    gtk_box_pack_start(GTK_BOX(main_box), exit_button, FALSE, FALSE, 5);
+    
+    gtk_widget_show_all(window);
+}
+
+// Parse the turbo options (GTK has already consumed its own); false on bad usage
+bool turbo_parse_args(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char *val = i + 1 < argc ? argv[i + 1] : "0";
+        if (strcmp(argv[i], "--turbo") == 0) {
+            turbo_speed = atof(val);
+            i++;
+        } else if (strcmp(argv[i], "--tables") == 0) {
+            turbo_tables = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--arrival-ms") == 0) {
+            turbo_arrival_ms = atof(val);
+            i++;
+        } else {
+            fprintf(stderr, "Usage: %s [--turbo SPEED (0 = unthrottled)] [--tables N] [--arrival-ms MS]\n", argv[0]);
+            return false;
+        }
+    }
+    if (turbo_tables < 1 || turbo_tables > MAX_TURBO_TABLES || turbo_arrival_ms <= 0) {
+        fprintf(stderr, "--tables must be 1..%d and --arrival-ms positive.\n", MAX_TURBO_TABLES);
+        return false;
+    }
+    return true;
+}
+
+// Headless engine at full or accelerated speed; the UI only samples it. Needs sim_seed set
+int turbo_run(void) {
+    pthread_t engine;
+    atomic_store(&turbo_running, true);
+    pthread_create(&engine, NULL, turbo_engine, NULL);
+    
+    // Table rows start empty (-1, since RED is 0); queue rows start at zero pressure
+    memset(heat, -1, sizeof(heat));
+    for (int c = 0; c < HEAT_COLUMNS; c++) {
+        heat[c][turbo_tables] = 0;
+        heat[c][turbo_tables + 1] = 0;
+    }
+    create_turbo_ui();
+    g_timeout_add(TURBO_FRAME_MS, turbo_frame, NULL);
+    gtk_main();
+    
+    atomic_store(&turbo_running, false);
+    pthread_join(engine, NULL);
+    return 0;
+}
+
+// Turbo rules: no balance rule here, only tables. The engine keeps counts rather than
+// arrival order, so the longer line is served first as the closest stand-in for FIFO
+static bool turbo_joins(const TurboSnapshot *state, CustomerColor color, RngStream *rng) {
+    (void)state;
+    (void)color;
+    (void)rng;
+    return true;
+}
+
+static int turbo_admit(const TurboSnapshot *state) {
+    if (state->red_waiting == 0 && state->blue_waiting == 0) {
+        return -1;
+    }
+    return state->red_waiting >= state->blue_waiting ? RED : BLUE;
+}
+
 int main(int argc, char *argv[]) {
+    gtk_init(&argc, &argv);
+    
+    // Turbo options (GTK has already consumed its own); turbo mode asks nothing
+    if (!turbo_parse_args(argc, argv)) {
+        return 1;
+    }
+    if (turbo_speed >= 0) {
+        sim_seed = choose_seed();
+        return turbo_run();
+    }
+    
     printf("Enter number of tables: ");
     scanf("%d", &NUM_TABLES);
     
-    printf("Enter maximum number of customers: ");
+    printf("Enter initial customer capacity: ");
     scanf("%d", &MAX_CUSTOMERS);
     
-    gtk_init(&argc, &argv);
-    
-    // Allocate memory for customers array
-    customers = (Customer*)malloc(MAX_CUSTOMERS * sizeof(Customer));
-    for (int i = 0; i < MAX_CUSTOMERS; i++) {
-        customers[i].id = i;
-        customers[i].in_bakery = false;
-        customers[i].table_num = -1;
-        customers[i].widget = NULL;
-    }
+    // Preallocate customer slots; more chunks are added if the bakery gets busier
+    slot_pool_init(MAX_CUSTOMERS);
     
     sem_init(&tables_sem, 0, NUM_TABLES);
-    srand(time(NULL));
+    table_owner = g_new(int, NUM_TABLES);
+    for (int i = 0; i < NUM_TABLES; i++) {
+        table_owner[i] = -1;
+    }
+    sim_seed = choose_seed();
     
     create_ui();
     g_timeout_add(500, update_ui, NULL);
@@ -352,8 +883,9 @@ int main(int argc, char *argv[]) {
     // Cleanup
     sem_destroy(&tables_sem);
     pthread_mutex_destroy(&mutex);
-    free(customers);
+    slot_pool_destroy();
     g_free(table_widgets);
+    g_free(table_owner);
     
     return 0;
 }
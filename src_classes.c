@@ -0,0 +1,474 @@
+/*
+ * Sweet Harmony Bakery - N Outfit Classes with Vectorized Balance Checks
+ *
+ * Generalizes the red/blue rule to N outfit classes (up to 64) under a
+ * "max - min <= k" balance constraint:
+ *
+ *   a customer of class c may enter if inside[c] + 1 - min <= k, or if c is
+ *   currently the least represented class (entering never hurts balance)
+ *
+ * Per-class occupancy and queue lengths live in small 32-byte aligned
+ * arrays. One query computes, in a single pass of min/max reductions:
+ *   - min and max occupancy
+ *   - the bitmask of classes that have someone waiting and may enter now
+ *   - the class that best restores balance: lowest occupancy among those,
+ *     then the longest line, then the lowest index
+ * A departure frees a table and the scheduler admits from that class until
+ * no line can be admitted. Arrivals walk straight in when their line is
+ * empty and the rule allows it.
+ *
+ * The query has scalar, SSE4.2 and AVX2 versions. Each one is compiled into
+ * its own copy of the replay loop, and the fastest the CPU supports is
+ * picked at startup (override with --impl). --bench replays the same
+ * workload with every version and checks that they make identical
+ * decisions.
+ *
+ * Build: gcc -O2 -Wall src_classes.c -o src_classes
+ *
+ * Example: ./src_classes --classes 32 --tolerance 2 --tables 128 --bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <immintrin.h>
+
+/* Constants */
+#define MAX_CLASSES 64           // Bitmask width of a query result
+#define PAD_OCCUPANCY (INT32_MAX / 2)  // Unused lanes: never the minimum, never admissible
+#define MAX_TABLES 65536         // Seated-customer ring capacity
+#define OP_DEPART 0xFF           // Workload code for "oldest diner leaves"
+#define ARRIVALS_PER_DEPARTURE 3
+
+/* Per-class state; arrays are padded to a multiple of 8 lanes */
+typedef struct {
+    _Alignas(32) int32_t inside[MAX_CLASSES];
+    _Alignas(32) int32_t waiting[MAX_CLASSES];
+    _Alignas(32) int32_t valid[MAX_CLASSES];   // -1 for real classes, 0 for padding
+    int classes;
+    int lanes;                   // classes rounded up to 8
+    int tolerance;               // k in max - min <= k
+} ClassState;
+
+/* Result of one balance query */
+typedef struct {
+    int32_t min;
+    int32_t max;
+    uint64_t admissible;         // Bit c set: class c is waiting and may enter
+    int best;                    // Class to admit next, -1 if none
+} ClassQuery;
+
+/* Workload: arrivals by class interleaved with departures */
+typedef struct {
+    uint8_t* ops;
+    long count;
+    int classes;
+    int tables;
+    int tolerance;
+} Workload;
+
+/* Outcome of a replay; equal digests mean equal decisions */
+typedef struct {
+    long admitted;
+    long peak_spread;            // Largest max - min observed after an admission
+    long max_line;               // Longest single-class line
+    uint64_t digest;
+    double seconds;
+} ReplayResult;
+
+typedef ReplayResult (*ReplayKernel)(const Workload* w);
+
+/* Function prototypes */
+void init_classes(ClassState* s, int classes, int tolerance);
+ReplayResult replay_scalar(const Workload* w);
+ReplayResult replay_sse42(const Workload* w);
+ReplayResult replay_avx2(const Workload* w);
+ReplayKernel pick_kernel(const char* name, const char** chosen);
+void make_workload(Workload* w, long count, int classes, int tables, int tolerance, uint64_t seed);
+
+/* Zero all classes and mark the padding lanes */
+void init_classes(ClassState* s, int classes, int tolerance) {
+    memset(s, 0, sizeof(*s));
+    s->classes = classes;
+    s->lanes = (classes + 7) & ~7;
+    s->tolerance = tolerance;
+    for (int c = 0; c < MAX_CLASSES; c++) {
+        s->valid[c] = c < classes ? -1 : 0;
+        s->inside[c] = c < classes ? 0 : PAD_OCCUPANCY;
+    }
+}
+
+/* Among the candidate classes, prefer the longest line, then the lowest index */
+static inline int longest_line(const ClassState* s, uint64_t candidates) {
+    int best = -1;
+    while (candidates != 0) {
+        int c = __builtin_ctzll(candidates);
+        candidates &= candidates - 1;
+        if (best < 0 || s->waiting[c] > s->waiting[best]) {
+            best = c;
+        }
+    }
+    return best;
+}
+
+/* Fewest diners of any class; only needed when an admission lifted the old minimum */
+static inline int32_t min_inside(const ClassState* s) {
+    int32_t low = INT32_MAX;
+    for (int c = 0; c < s->classes; c++) {
+        if (s->inside[c] < low) {
+            low = s->inside[c];
+        }
+    }
+    return low;
+}
+
+/* Reference query: one scalar pass for min/max, one for the masks */
+static inline ClassQuery query_scalar(const ClassState* s) {
+    ClassQuery q = { INT32_MAX, 0, 0, -1 };
+    for (int c = 0; c < s->classes; c++) {
+        if (s->inside[c] < q.min) {
+            q.min = s->inside[c];
+        }
+        if (s->inside[c] > q.max) {
+            q.max = s->inside[c];
+        }
+    }
+    int32_t limit = q.min + s->tolerance - 1;
+    int32_t lowest = INT32_MAX;
+    for (int c = 0; c < s->classes; c++) {
+        if (s->waiting[c] > 0 && (s->inside[c] <= limit || s->inside[c] == q.min)) {
+            q.admissible |= 1ULL << c;
+            if (s->inside[c] < lowest) {
+                lowest = s->inside[c];
+            }
+        }
+    }
+    uint64_t candidates = 0;
+    for (int c = 0; c < s->classes; c++) {
+        if (((q.admissible >> c) & 1) && s->inside[c] == lowest) {
+            candidates |= 1ULL << c;
+        }
+    }
+    q.best = longest_line(s, candidates);
+    return q;
+}
+
+/* Horizontal reductions over one 128-bit vector */
+__attribute__((target("sse4.2")))
+static inline int32_t hmin128(__m128i v) {
+    v = _mm_min_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_min_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+__attribute__((target("sse4.2")))
+static inline int32_t hmax128(__m128i v) {
+    v = _mm_max_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+/* SSE4.2 query: four classes per instruction */
+__attribute__((target("sse4.2")))
+static inline ClassQuery query_sse42(const ClassState* s) {
+    ClassQuery q = { 0, 0, 0, -1 };
+    __m128i vmin = _mm_set1_epi32(INT32_MAX);
+    __m128i vmax = _mm_setzero_si128();
+    for (int c = 0; c < s->lanes; c += 4) {
+        __m128i in = _mm_load_si128((const __m128i*)&s->inside[c]);
+        vmin = _mm_min_epi32(vmin, in);
+        vmax = _mm_max_epi32(vmax, _mm_and_si128(in, _mm_load_si128((const __m128i*)&s->valid[c])));
+    }
+    q.min = hmin128(vmin);
+    q.max = hmax128(vmax);
+
+    __m128i limit = _mm_set1_epi32(q.min + s->tolerance - 1);
+    __m128i at_min = _mm_set1_epi32(q.min);
+    __m128i zero = _mm_setzero_si128();
+    __m128i lowest = _mm_set1_epi32(INT32_MAX);
+    for (int c = 0; c < s->lanes; c += 4) {
+        __m128i in = _mm_load_si128((const __m128i*)&s->inside[c]);
+        __m128i wait = _mm_load_si128((const __m128i*)&s->waiting[c]);
+        __m128i ok = _mm_or_si128(_mm_andnot_si128(_mm_cmpgt_epi32(in, limit), _mm_set1_epi32(-1)),
+                                  _mm_cmpeq_epi32(in, at_min));
+        ok = _mm_and_si128(ok, _mm_cmpgt_epi32(wait, zero));
+        q.admissible |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(ok)) << c;
+        lowest = _mm_min_epi32(lowest, _mm_blendv_epi8(_mm_set1_epi32(INT32_MAX), in, ok));
+    }
+    if (q.admissible == 0) {
+        return q;
+    }
+
+    __m128i target = _mm_set1_epi32(hmin128(lowest));
+    uint64_t candidates = 0;
+    for (int c = 0; c < s->lanes; c += 4) {
+        __m128i in = _mm_load_si128((const __m128i*)&s->inside[c]);
+        candidates |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(in, target))) << c;
+    }
+    q.best = longest_line(s, candidates & q.admissible);
+    return q;
+}
+
+/* Horizontal reductions over one 256-bit vector */
+__attribute__((target("avx2")))
+static inline int32_t hmin256(__m256i v) {
+    __m128i m = _mm_min_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(m);
+}
+
+__attribute__((target("avx2")))
+static inline int32_t hmax256(__m256i v) {
+    __m128i m = _mm_max_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(m);
+}
+
+/* AVX2 query: eight classes per instruction, 64 classes in eight steps */
+__attribute__((target("avx2")))
+static inline ClassQuery query_avx2(const ClassState* s) {
+    ClassQuery q = { 0, 0, 0, -1 };
+    __m256i vmin = _mm256_set1_epi32(INT32_MAX);
+    __m256i vmax = _mm256_setzero_si256();
+    for (int c = 0; c < s->lanes; c += 8) {
+        __m256i in = _mm256_load_si256((const __m256i*)&s->inside[c]);
+        vmin = _mm256_min_epi32(vmin, in);
+        vmax = _mm256_max_epi32(vmax, _mm256_and_si256(in, _mm256_load_si256((const __m256i*)&s->valid[c])));
+    }
+    q.min = hmin256(vmin);
+    q.max = hmax256(vmax);
+
+    __m256i limit = _mm256_set1_epi32(q.min + s->tolerance - 1);
+    __m256i at_min = _mm256_set1_epi32(q.min);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i none = _mm256_set1_epi32(INT32_MAX);
+    __m256i lowest = none;
+    for (int c = 0; c < s->lanes; c += 8) {
+        __m256i in = _mm256_load_si256((const __m256i*)&s->inside[c]);
+        __m256i wait = _mm256_load_si256((const __m256i*)&s->waiting[c]);
+        __m256i ok = _mm256_or_si256(_mm256_andnot_si256(_mm256_cmpgt_epi32(in, limit), _mm256_set1_epi32(-1)),
+                                     _mm256_cmpeq_epi32(in, at_min));
+        ok = _mm256_and_si256(ok, _mm256_cmpgt_epi32(wait, zero));
+        q.admissible |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(ok)) << c;
+        lowest = _mm256_min_epi32(lowest, _mm256_blendv_epi8(none, in, ok));
+    }
+    if (q.admissible == 0) {
+        return q;
+    }
+
+    __m256i target = _mm256_set1_epi32(hmin256(lowest));
+    uint64_t candidates = 0;
+    for (int c = 0; c < s->lanes; c += 8) {
+        __m256i in = _mm256_load_si256((const __m256i*)&s->inside[c]);
+        candidates |= (uint64_t)(uint32_t)_mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpeq_epi32(in, target))) << c;
+    }
+    q.best = longest_line(s, candidates & q.admissible);
+    return q;
+}
+
+static double wall_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * The replay loop, written once and compiled per query implementation so
+ * the query is inlined into each copy.
+ */
+#define REPLAY_KERNEL(QUERY)                                                    \
+    static ClassState s;                                                        \
+    static uint8_t seated[MAX_TABLES];                                          \
+    ReplayResult r = { 0, 0, 0, 0xCBF29CE484222325ULL, 0 };                     \
+    int seated_head = 0, seated_count = 0, free_tables = w->tables;             \
+    init_classes(&s, w->classes, w->tolerance);                                 \
+    double start = wall_clock();                                                \
+    for (long op = 0; op < w->count; op++) {                                    \
+        int code = w->ops[op];                                                  \
+        if (code != OP_DEPART) {                                                \
+            s.waiting[code]++;                                                  \
+            if (s.waiting[code] > r.max_line) {                                 \
+                r.max_line = s.waiting[code];                                   \
+            }                                                                   \
+            if (s.waiting[code] > 1 || free_tables == 0) {                      \
+                continue;  /* Someone of this class is already in line */       \
+            }                                                                   \
+        } else {                                                                \
+            if (seated_count == 0) {                                            \
+                continue;                                                       \
+            }                                                                   \
+            s.inside[seated[seated_head]]--;                                    \
+            seated_head = (seated_head + 1) % MAX_TABLES;                       \
+            seated_count--;                                                     \
+            free_tables++;                                                      \
+        }                                                                       \
+        while (free_tables > 0) {                                               \
+            ClassQuery q = QUERY(&s);                                           \
+            int c = code != OP_DEPART ? ((q.admissible >> code) & 1 ? code : -1) : q.best; \
+            if (c < 0) {                                                        \
+                break;                                                          \
+            }                                                                   \
+            s.waiting[c]--;                                                     \
+            s.inside[c]++;                                                      \
+            free_tables--;                                                      \
+            seated[(seated_head + seated_count) % MAX_TABLES] = c;              \
+            seated_count++;                                                     \
+            r.admitted++;                                                       \
+            r.digest = (r.digest ^ (uint64_t)(op * MAX_CLASSES + c)) * 0x100000001B3ULL; \
+            int32_t high = s.inside[c] > q.max ? s.inside[c] : q.max;          \
+            int32_t low = s.inside[c] - 1 == q.min ? min_inside(&s) : q.min;    \
+            if (high - low > r.peak_spread) {                                   \
+                r.peak_spread = high - low;                                     \
+            }                                                                   \
+            if (code != OP_DEPART) {                                            \
+                break;  /* An arrival only seats itself */                      \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+    r.seconds = wall_clock() - start;                                           \
+    return r;
+
+ReplayResult replay_scalar(const Workload* w) {
+    REPLAY_KERNEL(query_scalar)
+}
+
+__attribute__((target("sse4.2")))
+ReplayResult replay_sse42(const Workload* w) {
+    REPLAY_KERNEL(query_sse42)
+}
+
+__attribute__((target("avx2")))
+ReplayResult replay_avx2(const Workload* w) {
+    REPLAY_KERNEL(query_avx2)
+}
+
+/* Choose a replay kernel by name, or the best supported one if name is NULL */
+ReplayKernel pick_kernel(const char* name, const char** chosen) {
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2");
+    bool sse42 = __builtin_cpu_supports("sse4.2");
+
+    if (name == NULL) {
+        name = avx2 ? "avx2" : sse42 ? "sse4.2" : "scalar";
+    }
+    *chosen = name;
+    if (strcmp(name, "avx2") == 0) {
+        return avx2 ? replay_avx2 : NULL;
+    }
+    if (strcmp(name, "sse4.2") == 0) {
+        return sse42 ? replay_sse42 : NULL;
+    }
+    if (strcmp(name, "scalar") == 0) {
+        return replay_scalar;
+    }
+    return NULL;
+}
+
+/* Arrivals spread uniformly over the classes, interleaved with departures */
+void make_workload(Workload* w, long count, int classes, int tables, int tolerance, uint64_t seed) {
+    w->ops = malloc(count);
+    w->count = count;
+    w->classes = classes;
+    w->tables = tables;
+    w->tolerance = tolerance;
+    uint64_t x = seed | 1;
+    for (long i = 0; i < count; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        int roll = (int)(x % (ARRIVALS_PER_DEPARTURE + 1));
+        w->ops[i] = roll == 0 ? OP_DEPART : (uint8_t)((x >> 32) % classes);
+    }
+}
+
+static void print_result(const char* name, const ReplayResult* r, long ops) {
+    printf("%-7s %10.1f M ops/s  admitted %ld  peak spread %ld  longest line %ld\n",
+           name, ops / r->seconds / 1e6, r->admitted, r->peak_spread, r->max_line);
+}
+
+/* Main function - replay driver */
+int main(int argc, char* argv[]) {
+    long ops = 20000000;
+    int classes = 16;
+    int tolerance = 2;
+    int tables = 128;
+    const char* impl = NULL;
+    bool bench = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* val = i + 1 < argc ? argv[i + 1] : "";
+        if (strcmp(argv[i], "--ops") == 0) {
+            ops = atol(val);
+            i++;
+        } else if (strcmp(argv[i], "--classes") == 0) {
+            classes = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--tolerance") == 0) {
+            tolerance = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--tables") == 0) {
+            tables = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--impl") == 0) {
+            impl = val;
+            i++;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--ops N] [--classes 1..%d] [--tolerance K] [--tables N] "
+                            "[--impl scalar|sse4.2|avx2] [--bench]\n", argv[0], MAX_CLASSES);
+            return 1;
+        }
+    }
+    if (ops < 1 || classes < 1 || classes > MAX_CLASSES || tolerance < 0 ||
+        tables < 1 || tables > MAX_TABLES) {
+        fprintf(stderr, "Need classes 1..%d, tolerance >= 0 and tables 1..%d.\n", MAX_CLASSES, MAX_TABLES);
+        return 1;
+    }
+
+    Workload w;
+    make_workload(&w, ops, classes, tables, tolerance, 0x2545F4914F6CDD1DULL);
+    printf("%ld operations, %d classes, max - min <= %d, %d tables\n",
+           ops, classes, tolerance, tables);
+
+    int status = 0;
+    if (bench) {
+        // Every available implementation must make the same decisions
+        const char* names[3] = { "scalar", "sse4.2", "avx2" };
+        ReplayResult reference = { 0 };
+        for (int k = 0; k < 3; k++) {
+            const char* chosen;
+            ReplayKernel kernel = pick_kernel(names[k], &chosen);
+            if (kernel == NULL) {
+                printf("%-7s not supported on this CPU\n", names[k]);
+                continue;
+            }
+            ReplayResult r = kernel(&w);
+            print_result(chosen, &r, ops);
+            if (k == 0) {
+                reference = r;
+            } else if (r.digest != reference.digest || r.admitted != reference.admitted) {
+                printf("%-7s MISMATCH against scalar\n", chosen);
+                status = 1;
+            }
+        }
+    } else {
+        const char* chosen;
+        ReplayKernel kernel = pick_kernel(impl, &chosen);
+        if (kernel == NULL) {
+            fprintf(stderr, "Implementation '%s' is unknown or unsupported here.\n", chosen);
+            return 1;
+        }
+        ReplayResult r = kernel(&w);
+        print_result(chosen, &r, ops);
+    }
+
+    free(w.ops);
+    return status;
+}
@@ -0,0 +1,808 @@
+/*
+ * Sweet Harmony Bakery - Coroutine Customer Model
+ *
+ * The customer logic of src_ds.c written as stackless coroutines instead of
+ * one blocking thread per customer. A customer awaits admission (a free
+ * table and the balance rule, claimed together as in src_ds.c), then its
+ * eating time, and leaves; the code reads as linearly as customer_behavior()
+ * in src_ds.c:
+ *
+ *     CO_BEGIN(c);
+ *     CO_AWAIT(c, await_admission(shard, c));
+ *     CO_AWAIT(c, await_sleep(shard, c, c->eating_time));
+ *     leave_bakery(shard, c);
+ *     CO_END(c);
+ *
+ * A suspended customer is just its Customer struct (a few dozen bytes)
+ * parked on a wait list or in the timer heap, so a million concurrent
+ * customers fit comfortably where a million thread stacks would not.
+ *
+ * Each core runs one single-threaded scheduler over its own shard (an
+ * independent bakery). Time is virtual: when nothing is runnable the shard
+ * clock jumps to the next timer.
+ *
+ * Placement: --pin compact puts shard k on the k-th allowed CPU (filling
+ * one NUMA node before the next), --pin scatter deals shards round-robin
+ * over the nodes, --pin none (default) leaves it to the kernel. The NUMA
+ * layout is read from /sys/devices/system/node, so no libnuma is needed.
+ * With --alloc local (default) each shard thread pins itself first and
+ * then allocates and zeroes its own Shard, customer pool and timer heap,
+ * so first-touch places every page on that thread's node; --alloc main
+ * allocates everything up front on the main thread, as before.
+ * --numa-bench runs the same workload under each placement and reports
+ * the throughput against the unpinned, main-allocated baseline.
+ *
+ * Build: gcc -O2 -Wall -pthread src_coro.c -o src_coro -lm
+ *
+ * Example: ./src_coro --customers 1000000 --burst --tables 64
+ *          ./src_coro --customers 4000000 --pin scatter
+ *          ./src_coro --customers 4000000 --burst --numa-bench
+ */
+
+#define _GNU_SOURCE              // sched_getaffinity, pthread_setaffinity_np
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <time.h>
+
+/* Constants */
+#define MAX_SHARDS 256
+#define US_PER_SECOND 1000000LL
+#define MAX_NODES 64             // NUMA node ids scanned in sysfs
+#define CACHE_LINE 64
+
+/*
+ * Stackless coroutines (protothread style). The resume point is stored in
+ * the coroutine's struct, so locals do not survive a CO_AWAIT: keep any
+ * state that must outlive a suspension in the struct itself.
+ */
+#define CO_BEGIN(co)        switch ((co)->co_state) { case 0:
+#define CO_AWAIT(co, ready) do { (co)->co_state = __LINE__; /* fallthrough */ case __LINE__: \
+                                 if (!(ready)) return CO_SUSPENDED; } while (0)
+#define CO_END(co)          } (co)->co_state = -1; return CO_DONE
+
+typedef enum {
+    CO_SUSPENDED = 0,            // Parked on a wait list or timer
+    CO_DONE = 1                  // Finished; may be freed
+} CoStatus;
+
+/* Color enumeration */
+typedef enum {
+    RED = 0,
+    BLUE = 1
+} CustomerColor;
+
+/* Counter-based RNG stream: the n-th draw is a pure function of (key, n) */
+typedef struct {
+    uint64_t key;
+    uint64_t counter;
+} RngStream;
+
+/* Customer coroutine */
+typedef struct Customer {
+    int co_state;                // Resume point; 0 = not started, -1 = finished
+    bool granted;                // Set by whoever completed our pending await
+    CustomerColor color;
+    long id;
+    int64_t arrival_time;        // Virtual time (us)
+    int64_t eating_time;
+    int64_t wake_time;           // Timer deadline while sleeping or not yet arrived
+    struct Customer* next;       // Intrusive link for run queue / wait lists
+} Customer;
+
+/* Intrusive FIFO of customers */
+typedef struct {
+    Customer* head;
+    Customer* tail;
+    long size;
+} CustomerList;
+
+/* One core's bakery and scheduler; touched only by its own thread */
+typedef struct {
+    int index;
+    long first_id;
+    long customer_count;
+    Customer* customers;
+
+    // Scheduler
+    int64_t now;                 // Virtual clock (us)
+    CustomerList run_queue;
+    Customer** timers;           // Min-heap on wake_time
+    long timer_count;
+
+    // Bakery state, as in src_ds.c
+    int tables;
+    int free_tables;
+    int red_count;
+    int blue_count;
+    int customers_inside;
+    CustomerList waiting[2];     // Awaiting admission, per color
+
+    // Statistics
+    long served[2];
+    long max_concurrent;         // Customers alive (arrived, not yet left)
+    int max_inside;              // Customers seated at once; never above tables
+    long alive;
+    int64_t total_wait;
+    long resumes;
+} Shard;
+
+/* Where shard threads run */
+typedef enum {
+    PIN_NONE = 0,                // Let the kernel schedule them
+    PIN_COMPACT,                 // Shard k on the k-th allowed CPU, node by node
+    PIN_SCATTER,                 // Round-robin over NUMA nodes
+    PIN_POLICY_COUNT
+} PinPolicy;
+
+/* Allowed CPUs grouped by NUMA node */
+typedef struct {
+    int cpu_count;
+    int cpus[CPU_SETSIZE];       // Node 0's CPUs, then node 1's, ...
+    int node_count;
+    int node_id[MAX_NODES + 1];  // sysfs node number of each group
+    int node_start[MAX_NODES + 1];
+    int node_size[MAX_NODES + 1];
+} Topology;
+
+/* Where one shard runs and where its state lives */
+typedef struct {
+    int index;
+    long first_id;
+    long customer_count;
+    int cpu;                     // CPU to pin to, -1 to float
+    Shard* shard;                // Allocated by main, or by the shard thread itself
+    pthread_t thread;
+} ShardLaunch;
+
+/* Totals over every shard of one run */
+typedef struct {
+    long served[2];
+    long resumes;
+    long peak;
+    int peak_inside;             // Most customers seated at once in any one shard
+    int64_t total_wait;
+    int64_t end_time;
+    double elapsed;              // Wall time from allocation to the last shard finishing
+} RunTotals;
+
+/* Run configuration shared by every shard */
+typedef struct {
+    long customers;
+    int tables;
+    double arrival_mean_ms;
+    double eat_min_s;
+    double eat_max_s;
+    bool burst;                  // Everyone arrives at time zero
+    uint64_t seed;
+    PinPolicy pin;
+    bool local_alloc;            // Shard threads allocate (and first-touch) their own state
+} CoroConfig;
+
+CoroConfig config = { 1000000, 64, 1.0, 1.0, 5.0, false, 1, PIN_NONE, true };
+
+/* Function prototypes */
+RngStream rng_stream(uint64_t seed, uint64_t stream_id);
+uint64_t rng_next(RngStream* stream);
+double rng_uniform(RngStream* stream);
+void list_push(CustomerList* list, Customer* c);
+Customer* list_pop(CustomerList* list);
+void timer_push(Shard* s, Customer* c);
+Customer* timer_pop(Shard* s);
+void wake(Shard* s, Customer* c);
+bool can_enter(Shard* s, CustomerColor color);
+void enter_bakery(Shard* s, Customer* c);
+void try_balance_entry(Shard* s);
+bool await_admission(Shard* s, Customer* c);
+bool await_sleep(Shard* s, Customer* c, int64_t duration);
+void leave_bakery(Shard* s, Customer* c);
+CoStatus customer_behavior(Shard* s, Customer* c);
+void topology_load(Topology* t);
+int topology_cpu(const Topology* t, PinPolicy pin, int k);
+Shard* shard_alloc(const ShardLaunch* launch);
+void shard_free(Shard* s);
+void* shard_main(void* arg);
+int run_shards(int shard_count, const Topology* topo, RunTotals* totals);
+int numa_bench(int shard_count, const Topology* topo);
+
+/* SplitMix64 finalizer: a strong 64-bit bijective mix */
+static uint64_t rng_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Derive an independent stream from a seed and a stream number */
+RngStream rng_stream(uint64_t seed, uint64_t stream_id) {
+    RngStream stream = { rng_mix(seed ^ rng_mix(stream_id + 0x9E3779B97F4A7C15ULL)), 0 };
+    return stream;
+}
+
+/* Next 64-bit draw */
+uint64_t rng_next(RngStream* stream) {
+    return rng_mix(stream->key + ++stream->counter * 0x9E3779B97F4A7C15ULL);
+}
+
+/* Uniform double in [0, 1) */
+double rng_uniform(RngStream* stream) {
+    return (rng_next(stream) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Append to an intrusive FIFO */
+void list_push(CustomerList* list, Customer* c) {
+    c->next = NULL;
+    if (list->tail != NULL) {
+        list->tail->next = c;
+    } else {
+        list->head = c;
+    }
+    list->tail = c;
+    list->size++;
+}
+
+/* Pop the oldest entry, or NULL */
+Customer* list_pop(CustomerList* list) {
+    Customer* c = list->head;
+    if (c != NULL) {
+        list->head = c->next;
+        if (list->head == NULL) {
+            list->tail = NULL;
+        }
+        list->size--;
+    }
+    return c;
+}
+
+/* Insert into the timer heap */
+void timer_push(Shard* s, Customer* c) {
+    long i = s->timer_count++;
+    while (i > 0) {
+        long parent = (i - 1) / 2;
+        if (s->timers[parent]->wake_time <= c->wake_time) {
+            break;
+        }
+        s->timers[i] = s->timers[parent];
+        i = parent;
+    }
+    s->timers[i] = c;
+}
+
+/* Remove the earliest timer; caller checks timer_count first */
+Customer* timer_pop(Shard* s) {
+    Customer* top = s->timers[0];
+    Customer* last = s->timers[--s->timer_count];
+    long n = s->timer_count;
+    long i = 0;
+
+    while (2 * i + 1 < n) {
+        long child = 2 * i + 1;
+        if (child + 1 < n && s->timers[child + 1]->wake_time < s->timers[child]->wake_time) {
+            child++;
+        }
+        if (last->wake_time <= s->timers[child]->wake_time) {
+            break;
+        }
+        s->timers[i] = s->timers[child];
+        i = child;
+    }
+    s->timers[i] = last;
+    return top;
+}
+
+/* Complete a parked customer's await and make it runnable */
+void wake(Shard* s, Customer* c) {
+    c->granted = true;
+    list_push(&s->run_queue, c);
+}
+
+/* Check if a customer of given color can enter based on balance rule */
+bool can_enter(Shard* s, CustomerColor color) {
+    if (s->free_tables == 0) {
+        return false;
+    }
+    if (s->customers_inside == 0) {
+        return true;
+    }
+    if (color == RED) {
+        return s->red_count < s->blue_count;
+    }
+    return s->blue_count < s->red_count;
+}
+
+/* Count a customer as inside, at the table they were admitted to */
+void enter_bakery(Shard* s, Customer* c) {
+    s->free_tables--;
+    if (c->color == RED) {
+        s->red_count++;
+    } else {
+        s->blue_count++;
+    }
+    s->customers_inside++;
+    if (s->customers_inside > s->max_inside) {
+        s->max_inside = s->customers_inside;
+    }
+}
+
+/* Admit waiting customers while there are free tables and the balance rule allows it */
+void try_balance_entry(Shard* s) {
+    while (s->free_tables > 0) {
+        CustomerList* red = &s->waiting[RED];
+        CustomerList* blue = &s->waiting[BLUE];
+        CustomerList* line = NULL;
+
+        if (s->customers_inside == 0 || s->red_count == s->blue_count) {
+            if (red->size > 0 || blue->size > 0) {
+                line = red->size >= blue->size ? red : blue;
+            }
+        } else if (s->red_count < s->blue_count && red->size > 0) {
+            line = red;
+        } else if (s->blue_count < s->red_count && blue->size > 0) {
+            line = blue;
+        }
+        if (line == NULL) {
+            return;
+        }
+
+        Customer* c = list_pop(line);
+        enter_bakery(s, c);
+        wake(s, c);
+    }
+}
+
+/* Awaitable: enter the bakery and take a table once both are available */
+bool await_admission(Shard* s, Customer* c) {
+    if (c->granted) {
+        c->granted = false;      // try_balance_entry already let us in and seated us
+        return true;
+    }
+    if (s->waiting[c->color].size == 0 && can_enter(s, c->color)) {
+        enter_bakery(s, c);
+        return true;
+    }
+    list_push(&s->waiting[c->color], c);
+    return false;
+}
+
+/* Awaitable: let virtual time pass */
+bool await_sleep(Shard* s, Customer* c, int64_t duration) {
+    if (c->granted) {
+        c->granted = false;
+        return true;
+    }
+    c->wake_time = s->now + duration;
+    timer_push(s, c);
+    return false;
+}
+
+/* Give up the table and let waiting customers in */
+void leave_bakery(Shard* s, Customer* c) {
+    if (c->color == RED) {
+        s->red_count--;
+    } else {
+        s->blue_count--;
+    }
+    s->customers_inside--;
+    s->free_tables++;
+    s->served[c->color]++;
+    try_balance_entry(s);
+}
+
+/* Customer coroutine: the same steps as customer_behavior() in src_ds.c */
+CoStatus customer_behavior(Shard* s, Customer* c) {
+    CO_BEGIN(c);
+
+    c->arrival_time = s->now;
+    s->alive++;
+    if (s->alive > s->max_concurrent) {
+        s->max_concurrent = s->alive;
+    }
+
+    CO_AWAIT(c, await_admission(s, c));
+    s->total_wait += s->now - c->arrival_time;
+
+    CO_AWAIT(c, await_sleep(s, c, c->eating_time));
+    leave_bakery(s, c);
+    s->alive--;
+
+    CO_END(c);
+}
+
+/* Name of a pin policy, as given to --pin */
+static const char* pin_policy_name(PinPolicy pin) {
+    static const char* names[PIN_POLICY_COUNT] = { "none", "compact", "scatter" };
+    return names[pin];
+}
+
+/* Add the allowed CPUs in a sysfs cpulist ("0-3,8-11") to the topology */
+static void topology_add_cpulist(Topology* t, const char* text, cpu_set_t* allowed) {
+    const char* p = text;
+    for (;;) {
+        char* end;
+        long lo = strtol(p, &end, 10);
+        if (end == p) {
+            return;
+        }
+        long hi = lo;
+        if (*end == '-') {
+            hi = strtol(end + 1, &end, 10);
+        }
+        for (long cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, allowed)) {
+                CPU_CLR(cpu, allowed);   // Each CPU is listed once
+                t->cpus[t->cpu_count++] = (int)cpu;
+            }
+        }
+        if (*end != ',') {
+            return;
+        }
+        p = end + 1;
+    }
+}
+
+/* Close the group of CPUs added since start as one node */
+static void topology_end_node(Topology* t, int node_id, int start) {
+    if (t->cpu_count > start) {
+        t->node_id[t->node_count] = node_id;
+        t->node_start[t->node_count] = start;
+        t->node_size[t->node_count] = t->cpu_count - start;
+        t->node_count++;
+    }
+}
+
+/* Read the CPUs we may run on and the NUMA node of each */
+void topology_load(Topology* t) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long cpu = 0; cpu < online && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, &allowed);
+        }
+    }
+    t->cpu_count = 0;
+    t->node_count = 0;
+
+    // Node ids may be sparse, so every id up to MAX_NODES is tried
+    for (int node = 0; node < MAX_NODES; node++) {
+        char path[64];
+        char text[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE* file = fopen(path, "r");
+        if (file == NULL) {
+            continue;
+        }
+        bool ok = fgets(text, sizeof(text), file) != NULL;
+        fclose(file);
+        if (ok) {
+            int start = t->cpu_count;
+            topology_add_cpulist(t, text, &allowed);
+            topology_end_node(t, node, start);
+        }
+    }
+
+    // CPUs no node claimed (no sysfs, or a kernel without NUMA) form one more node
+    int start = t->cpu_count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            t->cpus[t->cpu_count++] = cpu;
+        }
+    }
+    topology_end_node(t, t->node_count == 0 ? 0 : -1, start);
+}
+
+/* CPU for shard k under a pin policy, or -1 to leave it unpinned */
+int topology_cpu(const Topology* t, PinPolicy pin, int k) {
+    if (pin == PIN_NONE || t->cpu_count == 0) {
+        return -1;
+    }
+    if (pin == PIN_COMPACT) {
+        return t->cpus[k % t->cpu_count];
+    }
+    int node = k % t->node_count;
+    int slot = (k / t->node_count) % t->node_size[node];
+    return t->cpus[t->node_start[node] + slot];
+}
+
+/*
+ * Allocate a shard with its customer pool and timer heap. Every page is
+ * written here, so under Linux's first-touch policy the memory lands on
+ * the NUMA node of the calling thread. The Shard itself gets whole cache
+ * lines, so neighbouring shards never share one.
+ */
+Shard* shard_alloc(const ShardLaunch* launch) {
+    size_t size = (sizeof(Shard) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    long slots = launch->customer_count ? launch->customer_count : 1;
+    Shard* s = aligned_alloc(CACHE_LINE, size);
+    if (s == NULL) {
+        return NULL;
+    }
+    memset(s, 0, size);
+    s->customers = malloc(slots * sizeof(Customer));
+    s->timers = malloc(slots * sizeof(Customer*));
+    if (s->customers == NULL || s->timers == NULL) {
+        shard_free(s);
+        return NULL;
+    }
+    memset(s->customers, 0, slots * sizeof(Customer));
+    memset(s->timers, 0, slots * sizeof(Customer*));
+
+    s->index = launch->index;
+    s->first_id = launch->first_id;
+    s->customer_count = launch->customer_count;
+    s->tables = s->free_tables = config.tables;
+    return s;
+}
+
+void shard_free(Shard* s) {
+    free(s->customers);
+    free(s->timers);
+    free(s);
+}
+
+/* Scheduler loop for one shard */
+void* shard_main(void* arg) {
+    ShardLaunch* launch = (ShardLaunch*)arg;
+
+    // Pin before allocating, so first-touch uses this CPU's node
+    if (launch->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(launch->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    if (launch->shard == NULL) {
+        launch->shard = shard_alloc(launch);
+        if (launch->shard == NULL) {
+            return NULL;
+        }
+    }
+
+    Shard* s = launch->shard;
+    RngStream rng = rng_stream(config.seed, s->index);
+    int64_t arrival = 0;
+
+    // Every customer starts as a timer that fires at its arrival time
+    for (long i = 0; i < s->customer_count; i++) {
+        Customer* c = &s->customers[i];
+        double eat = config.eat_min_s + rng_uniform(&rng) * (config.eat_max_s - config.eat_min_s);
+        c->id = s->first_id + i;
+        c->color = (rng_next(&rng) >> 63) ? BLUE : RED;
+        c->eating_time = (int64_t)(eat * US_PER_SECOND);
+        c->wake_time = arrival;
+        timer_push(s, c);
+        if (!config.burst) {
+            arrival += (int64_t)(-config.arrival_mean_ms * 1000.0 * log1p(-rng_uniform(&rng)));
+        }
+    }
+
+    for (;;) {
+        Customer* c;
+        while ((c = list_pop(&s->run_queue)) != NULL) {
+            customer_behavior(s, c);
+            s->resumes++;
+        }
+        if (s->timer_count == 0) {
+            break;
+        }
+
+        // Nothing runnable: jump the clock to the next timer and fire all due ones
+        s->now = s->timers[0]->wake_time;
+        while (s->timer_count > 0 && s->timers[0]->wake_time <= s->now) {
+            c = timer_pop(s);
+            if (c->co_state == 0) {
+                list_push(&s->run_queue, c);  // Arrival: start the coroutine
+            } else {
+                wake(s, c);
+            }
+        }
+    }
+    return NULL;
+}
+
+static double wall_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Run every shard under config's placement; 0 on success */
+int run_shards(int shard_count, const Topology* topo, RunTotals* totals) {
+    ShardLaunch launches[MAX_SHARDS];
+    long next_id = 1;
+    int status = 0;
+
+    // Allocation is timed too: with --alloc local the shard threads pay for it
+    double start = wall_clock();
+
+    // Split customers evenly; each shard is an independent bakery
+    for (int k = 0; k < shard_count; k++) {
+        ShardLaunch* l = &launches[k];
+        l->index = k;
+        l->customer_count = config.customers / shard_count + (k < config.customers % shard_count);
+        l->first_id = next_id;
+        next_id += l->customer_count;
+        l->cpu = topology_cpu(topo, config.pin, k);
+        l->shard = NULL;
+        if (!config.local_alloc && (l->shard = shard_alloc(l)) == NULL) {
+            perror("Error allocating customers");
+            return 1;
+        }
+    }
+
+    for (int k = 0; k < shard_count; k++) {
+        if (pthread_create(&launches[k].thread, NULL, shard_main, &launches[k]) != 0) {
+            perror("Error creating scheduler thread");
+            return 1;
+        }
+    }
+    for (int k = 0; k < shard_count; k++) {
+        pthread_join(launches[k].thread, NULL);
+    }
+    totals->elapsed = wall_clock() - start;
+
+    memset(totals->served, 0, sizeof(totals->served));
+    totals->resumes = totals->peak = 0;
+    totals->peak_inside = 0;
+    totals->total_wait = totals->end_time = 0;
+    for (int k = 0; k < shard_count; k++) {
+        Shard* s = launches[k].shard;
+        if (s == NULL) {
+            fprintf(stderr, "Shard %d could not allocate its customers.\n", k);
+            status = 1;
+            continue;
+        }
+        totals->served[RED] += s->served[RED];
+        totals->served[BLUE] += s->served[BLUE];
+        totals->resumes += s->resumes;
+        totals->peak += s->max_concurrent;
+        if (s->max_inside > totals->peak_inside) {
+            totals->peak_inside = s->max_inside;
+        }
+        totals->total_wait += s->total_wait;
+        if (s->now > totals->end_time) {
+            totals->end_time = s->now;
+        }
+        shard_free(s);
+    }
+    return status;
+}
+
+/*
+ * Placement benchmark: the same seeded workload under each pin policy and
+ * allocation mode. Results must match exactly (shards are deterministic);
+ * only the wall time may differ. On a single-node machine the spread
+ * shows the effect of pinning alone.
+ */
+int numa_bench(int shard_count, const Topology* topo) {
+    static const struct { PinPolicy pin; bool local_alloc; } runs[] = {
+        { PIN_NONE, false },     // Baseline: unpinned, everything on main's node
+        { PIN_NONE, true },
+        { PIN_COMPACT, true },
+        { PIN_SCATTER, true },
+        { PIN_SCATTER, false },  // Spread threads, memory still on main's node
+    };
+    int run_count = (int)(sizeof(runs) / sizeof(runs[0]));
+    double baseline = 0;
+    long expected[2] = { 0, 0 };
+    int failed = 0;
+
+    printf("NUMA bench: %ld customers on %d shard(s), %d CPU(s) on %d node(s)\n",
+           config.customers, shard_count, topo->cpu_count, topo->node_count);
+    if (topo->node_count < 2) {
+        printf("Only one NUMA node: differences below come from pinning alone.\n");
+    }
+    printf("\n%-8s %-6s %10s %14s %10s\n", "pin", "alloc", "wall s", "M resumes/s", "vs base");
+
+    for (int r = 0; r < run_count; r++) {
+        RunTotals totals;
+        config.pin = runs[r].pin;
+        config.local_alloc = runs[r].local_alloc;
+        if (run_shards(shard_count, topo, &totals) != 0) {
+            return 1;
+        }
+        double rate = totals.resumes / totals.elapsed / 1e6;
+        if (r == 0) {
+            baseline = rate;
+            expected[RED] = totals.served[RED];
+            expected[BLUE] = totals.served[BLUE];
+        }
+        bool same = totals.served[RED] == expected[RED] && totals.served[BLUE] == expected[BLUE];
+        failed |= !same;
+        printf("%-8s %-6s %10.3f %14.2f %9.2fx%s\n", pin_policy_name(runs[r].pin),
+               runs[r].local_alloc ? "local" : "main", totals.elapsed, rate, rate / baseline,
+               same ? "" : "  RESULTS DIFFER");
+    }
+    return failed;
+}
+
+/* Main function - command line driver */
+int main(int argc, char* argv[]) {
+    int shard_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    bool bench = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = i + 1 < argc ? argv[i + 1] : "";
+        if (strcmp(arg, "--customers") == 0) {
+            config.customers = atol(val);
+            i++;
+        } else if (strcmp(arg, "--tables") == 0) {
+            config.tables = atoi(val);
+            i++;
+        } else if (strcmp(arg, "--threads") == 0) {
+            shard_count = atoi(val);
+            i++;
+        } else if (strcmp(arg, "--arrival-ms") == 0) {
+            config.arrival_mean_ms = atof(val);
+            i++;
+        } else if (strcmp(arg, "--seed") == 0) {
+            config.seed = strtoull(val, NULL, 10);
+            i++;
+        } else if (strcmp(arg, "--burst") == 0) {
+            config.burst = true;
+        } else if (strcmp(arg, "--pin") == 0 &&
+                   (strcmp(val, "none") == 0 || strcmp(val, "compact") == 0 || strcmp(val, "scatter") == 0)) {
+            config.pin = val[0] == 'n' ? PIN_NONE : val[0] == 'c' ? PIN_COMPACT : PIN_SCATTER;
+            i++;
+        } else if (strcmp(arg, "--alloc") == 0 && (strcmp(val, "local") == 0 || strcmp(val, "main") == 0)) {
+            config.local_alloc = val[0] == 'l';
+            i++;
+        } else if (strcmp(arg, "--numa-bench") == 0) {
+            bench = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--customers N] [--tables N] [--threads N] "
+                            "[--arrival-ms X] [--seed N] [--burst] [--pin none|compact|scatter] "
+                            "[--alloc local|main] [--numa-bench]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (shard_count < 1) {
+        shard_count = 1;
+    }
+    if (shard_count > MAX_SHARDS) {
+        shard_count = MAX_SHARDS;
+    }
+    if (config.customers < 1 || config.tables < 1) {
+        fprintf(stderr, "Need at least one customer and one table.\n");
+        return 1;
+    }
+
+    static Topology topo;
+    topology_load(&topo);
+    if (bench) {
+        return numa_bench(shard_count, &topo);
+    }
+
+    printf("Simulating %ld customers on %d shard(s), %d tables each, %zu bytes per customer\n",
+           config.customers, shard_count, config.tables, sizeof(Customer));
+    printf("Placement: pin %s over %d CPU(s) on %d node(s), shard state allocated by %s\n",
+           pin_policy_name(config.pin), topo.cpu_count, topo.node_count,
+           config.local_alloc ? "each shard thread" : "the main thread");
+
+    RunTotals totals;
+    if (run_shards(shard_count, &topo, &totals) != 0) {
+        return 1;
+    }
+
+    long total = totals.served[RED] + totals.served[BLUE];
+    printf("Summary:\n");
+    printf("- Red customers served: %ld\n", totals.served[RED]);
+    printf("- Blue customers served: %ld\n", totals.served[BLUE]);
+    printf("- Total customers: %ld\n", total);
+    printf("- Peak concurrent customers: %ld (%.1f MB of coroutine state)\n",
+           totals.peak, totals.peak * sizeof(Customer) / 1e6);
+    printf("- Peak customers seated: %d of %d tables per shard\n", totals.peak_inside, config.tables);
+    printf("- Average wait: %.3f s, virtual time: %.1f s\n",
+           total ? totals.total_wait / (double)total / US_PER_SECOND : 0.0,
+           totals.end_time / (double)US_PER_SECOND);
+    printf("- Wall time: %.3f s (%.1f M resumes/s)\n", totals.elapsed, totals.resumes / totals.elapsed / 1e6);
+    printf("Sweet Harmony bakery is now closed.\n");
+    return 0;
+}
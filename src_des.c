@@ -0,0 +1,1376 @@
+/*
+ * Sweet Harmony Bakery - Virtual-Time (Discrete-Event) Simulation
+ *
+ * This file runs the same model as src_ds.c (balanced red/blue admission,
+ * limited tables, per-color waiting queues) on a virtual clock instead of
+ * real threads and sleeps, so runs of millions of customers finish in
+ * seconds.
+ *
+ * The whole simulation lives in a single pointer-free SimState (customer
+ * pool, queues, pending event heap, RNG state, statistics). That makes
+ * checkpointing a plain write of the struct, and restoring an mmap of the
+ * snapshot file with no parsing. Restored state is mapped copy-on-write, so
+ * one midday snapshot can be forked into many what-if runs.
+ *
+ * Randomness comes from counter-based RNG streams, one per purpose
+ * (arrival gaps, colors, eating times), so a run is bit-for-bit
+ * reproducible from its seed.
+ *
+ * With --records FILE every completed visit (arrival, seat and leave times,
+ * color) is appended to a columnar record file for src_stats.c.
+ *
+ * A bounded timeline of occupancy, queue length, arrivals and admissions is
+ * kept incrementally in per-second buckets and consolidated into per-minute
+ * and per-hour tiers, like a round-robin database. --timeline FILE dumps it
+ * as CSV for plotting.
+ *
+ * --estimate prints an analytic steady-state estimate (utilization, chance
+ * of queueing, mean and p99 wait) computed in microseconds from the same
+ * parameters, then runs the simulation and reports how far the two
+ * diverge. --estimate-only skips the simulation, so sweeps can prune
+ * unpromising regions before paying for a run.
+ *
+ * --tune-p99 S sizes a store: for each admission tolerance 0..3 it
+ * searches for the fewest tables whose simulated p99 queue wait is at most
+ * S seconds, and prints the cheapest configuration. Each search warms up
+ * once and forks every trial from that state, running --tune-jobs trials
+ * in parallel.
+ *
+ * Build: gcc -O2 -Wall src_des.c -o src_des -lm
+ *
+ * Examples:
+ *   ./src_des --customers 10000000 --checkpoint midday.snap --checkpoint-at 5000000
+ *   ./src_des --restore midday.snap
+ *   ./src_des --restore midday.snap --tables 8 --fork 4
+ *   ./src_des --arrival-ms 50 --customers 200000 --tune-p99 300
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/* Constants */
+#define MAX_INFLIGHT (1 << 16)   // Customers inside or queued at the same time
+#define SNAPSHOT_MAGIC 0x314d485445455753ULL  // "SWEETHM1"
+#define SNAPSHOT_VERSION 5
+#define US_PER_SECOND 1000000LL
+#define RECORD_MAGIC 0x3143455254455753ULL  // "SWTREC1"
+#define RECORD_BLOCK 65536       // Records per columnar block
+#define TIMELINE_TIERS 3         // 1 s, 1 min and 1 h buckets
+#define TIMELINE_SLOTS 3600      // Buckets retained per tier
+#define WAIT_BUCKETS 256         // Eighth-octave buckets of (wait ms + 1)
+#define MAX_TUNE_JOBS 64         // Trials run in parallel per search round
+#define MAX_TUNE_TOLERANCE 3     // Admission tolerances tried by the tuner
+
+/* Color enumeration */
+typedef enum {
+    RED = 0,
+    BLUE = 1
+} CustomerColor;
+
+/* Event types in the pending event set */
+typedef enum {
+    EV_ARRIVAL = 0,              // Next customer arrives
+    EV_DEPART = 1                // Seated customer finishes eating
+} EventType;
+
+/* Simulation parameters (part of the snapshot, some overridable on restore) */
+typedef struct {
+    int tables;                  // Number of tables
+    long total_customers;        // Customers to generate over the whole run
+    double arrival_mean_ms;      // Mean inter-arrival time (exponential)
+    double eat_min_s;            // Eating time is uniform in [eat_min_s, eat_max_s]
+    double eat_max_s;
+    uint64_t seed;               // Seed the RNG was started from
+    int tolerance;               // Admission policy: how far ahead a color may get (0 = strict)
+} SimParams;
+
+/* In-flight customer; slots are recycled through a free list */
+typedef struct {
+    long id;                     // Unique customer ID
+    CustomerColor color;         // RED or BLUE outfit
+    int next_free;               // Next free slot, or -1
+    int64_t arrival_time;        // Virtual arrival time (us)
+    int64_t eating_time;         // Virtual time spent at the table (us)
+} SimCustomer;
+
+/* Counter-based RNG stream: the n-th draw is a pure function of (key, n) */
+typedef struct {
+    uint64_t key;
+    uint64_t counter;
+} RngStream;
+
+/* Independent streams used by the model */
+typedef enum {
+    STREAM_ARRIVALS = 0,         // Inter-arrival gaps
+    STREAM_COLORS = 1,           // Outfit colors
+    STREAM_EATING = 2,           // Eating times
+    STREAM_COUNT
+} StreamId;
+
+/* Pending event; ordered by (time, seq) so ties resolve deterministically */
+typedef struct {
+    int64_t time;
+    int64_t seq;
+    EventType type;
+    int customer;                // Pool slot, or -1 for arrivals
+} Event;
+
+/* Ring buffer of pool slots waiting outside */
+typedef struct {
+    int slots[MAX_INFLIGHT];
+    int front;
+    int size;
+} SimQueue;
+
+/* Aggregates for one fixed-width slice of virtual time */
+typedef struct {
+    int64_t start;               // Bucket start (us)
+    int64_t occupancy_area;      // Integral of customers inside over time (customer-us)
+    int64_t queue_area;          // Integral of customers waiting over time
+    int32_t max_occupancy;
+    int32_t max_queue;
+    int32_t arrivals;
+    int32_t admissions;
+} TimeBucket;
+
+/* One resolution level: a ring of closed buckets plus the one being filled */
+typedef struct {
+    int64_t width;               // Bucket width (us)
+    int head;                    // Oldest retained bucket
+    int count;
+    TimeBucket current;
+    TimeBucket ring[TIMELINE_SLOTS];
+} TimelineTier;
+
+/* Multi-resolution timeline, updated incrementally on every event */
+typedef struct {
+    int64_t last_update;         // Virtual time integrated up to
+    int occupancy;               // Levels in effect since last_update
+    int queue;
+    TimelineTier tiers[TIMELINE_TIERS];
+} Timeline;
+
+/* Complete simulation state; contains no pointers so it can be mmapped back */
+typedef struct {
+    SimParams params;
+
+    int64_t now;                 // Virtual clock (us)
+    int64_t event_seq;           // Tie-breaker for simultaneous events
+    long events_processed;
+    long customers_generated;
+
+    // Bakery state, as in src_ds.c
+    int customers_inside;
+    int red_count;
+    int blue_count;
+    int free_tables;
+    SimQueue queues[2];          // Indexed by CustomerColor
+
+    // Customer pool
+    SimCustomer pool[MAX_INFLIGHT];
+    int free_head;
+    int inflight;
+
+    // Pending event set (binary min-heap)
+    Event events[MAX_INFLIGHT + 1];
+    int event_count;
+
+    RngStream rng[STREAM_COUNT]; // One stream per StreamId
+
+    // Statistics
+    long served[2];
+    long queued;
+    long rejected;               // Turned away because MAX_INFLIGHT was reached
+    int64_t total_wait;
+    int64_t max_wait;
+    int64_t total_eating;        // Table time taken by seated customers (us)
+    int64_t wait_hist[WAIT_BUCKETS];
+
+    Timeline timeline;
+} SimState;
+
+/* Snapshot file header; the SimState follows immediately after it */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t state_size;
+    uint64_t reserved[5];        // Pads the header to 64 bytes
+} SnapshotHeader;
+
+/*
+ * Columnar record file: a RecordFileHeader, then blocks of up to
+ * RECORD_BLOCK records, each an int64 count followed by the arrival, seat
+ * and leave columns (int64 us) and the color column (uint8, padded to 8).
+ */
+typedef struct {
+    uint64_t magic;
+    uint64_t block_records;
+} RecordFileHeader;
+
+/* Buffers one block of completed-customer records before writing it */
+typedef struct {
+    FILE* file;
+    int64_t count;
+    int64_t arrival[RECORD_BLOCK];
+    int64_t seat[RECORD_BLOCK];
+    int64_t leave[RECORD_BLOCK];
+    uint8_t color[RECORD_BLOCK];
+} RecordWriter;
+
+/* Analytic steady-state estimate of the simulated system */
+typedef struct {
+    bool stable;                 // Offered load below table capacity
+    double utilization;          // Fraction of table time in use
+    double p_queue;              // Chance that an arrival has to wait in line
+    double mean_wait_s;
+    double p99_wait_s;
+} Estimate;
+
+/* One auto-tuner trial: a configuration and what the simulation measured */
+typedef struct {
+    int tables;
+    int tolerance;
+    double p99_wait_s;
+    double mean_wait_s;
+    long rejected;
+} TuneTrial;
+
+/* Global state */
+volatile sig_atomic_t interrupted = 0;
+RecordWriter* records = NULL;    // Not part of the snapshot; NULL unless --records
+
+/* Function prototypes */
+void init_sim(SimState* sim, const SimParams* params);
+uint64_t rng_mix(uint64_t z);
+RngStream rng_stream(uint64_t seed, uint64_t stream_id);
+uint64_t rng_next(RngStream* stream);
+double rng_uniform(RngStream* stream);
+void seed_streams(SimState* sim, uint64_t seed);
+void push_event(SimState* sim, int64_t time, EventType type, int customer);
+Event pop_event(SimState* sim);
+int alloc_customer(SimState* sim);
+void free_customer(SimState* sim, int slot);
+bool can_enter(SimState* sim, CustomerColor color);
+void seat_customer(SimState* sim, int slot);
+void try_balance_entry(SimState* sim);
+void handle_arrival(SimState* sim);
+void handle_departure(SimState* sim, int slot);
+void timeline_init(Timeline* tl);
+void timeline_advance(Timeline* tl, int64_t now);
+void timeline_observe(Timeline* tl, int occupancy, int queue);
+int save_timeline(const Timeline* tl, const char* path);
+bool run_sim(SimState* sim, long stop_after_events);
+int save_snapshot(const SimState* sim, const char* path);
+SimState* map_snapshot(const char* path, size_t* mapped_size);
+void print_summary(const SimState* sim, double wall_seconds);
+double wait_percentile(const SimState* sim, double q);
+Estimate estimate_queue(const SimParams* params);
+void print_estimate(const Estimate* est, double compute_us, const SimState* sim);
+int auto_tune(const SimParams* base, double slo_s, int max_tables, int jobs);
+RecordWriter* open_records(const char* path);
+void flush_records(RecordWriter* writer);
+void close_records(RecordWriter* writer);
+
+/* Initialize a fresh simulation and schedule the first arrival */
+void init_sim(SimState* sim, const SimParams* params) {
+    memset(sim, 0, sizeof(*sim));
+    sim->params = *params;
+    sim->free_tables = params->tables;
+    seed_streams(sim, params->seed);
+    timeline_init(&sim->timeline);
+
+    // Chain every pool slot into the free list
+    for (int i = 0; i < MAX_INFLIGHT; i++) {
+        sim->pool[i].next_free = i + 1 < MAX_INFLIGHT ? i + 1 : -1;
+    }
+    sim->free_head = 0;
+
+    if (params->total_customers > 0) {
+        push_event(sim, 0, EV_ARRIVAL, -1);
+    }
+}
+
+/* SplitMix64 finalizer: a strong 64-bit bijective mix */
+uint64_t rng_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Derive an independent stream from a seed and a stream number */
+RngStream rng_stream(uint64_t seed, uint64_t stream_id) {
+    RngStream stream = { rng_mix(seed ^ rng_mix(stream_id + 0x9E3779B97F4A7C15ULL)), 0 };
+    return stream;
+}
+
+/* Next 64-bit draw; no shared state, so streams never contend */
+uint64_t rng_next(RngStream* stream) {
+    return rng_mix(stream->key + ++stream->counter * 0x9E3779B97F4A7C15ULL);
+}
+
+/* Uniform double in [0, 1) */
+double rng_uniform(RngStream* stream) {
+    return (rng_next(stream) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Restart every model stream from the given seed */
+void seed_streams(SimState* sim, uint64_t seed) {
+    for (int i = 0; i < STREAM_COUNT; i++) {
+        sim->rng[i] = rng_stream(seed, i);
+    }
+}
+
+/* Insert an event into the heap */
+void push_event(SimState* sim, int64_t time, EventType type, int customer) {
+    int i = sim->event_count++;
+    Event ev = { time, sim->event_seq++, type, customer };
+
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        Event* p = &sim->events[parent];
+        if (p->time < ev.time || (p->time == ev.time && p->seq < ev.seq)) {
+            break;
+        }
+        sim->events[i] = *p;
+        i = parent;
+    }
+    sim->events[i] = ev;
+}
+
+/* Remove and return the earliest event; caller checks event_count first */
+Event pop_event(SimState* sim) {
+    Event top = sim->events[0];
+    Event last = sim->events[--sim->event_count];
+    int n = sim->event_count;
+    int i = 0;
+
+    while (2 * i + 1 < n) {
+        int child = 2 * i + 1;
+        Event* c = &sim->events[child];
+        if (child + 1 < n) {
+            Event* r = &sim->events[child + 1];
+            if (r->time < c->time || (r->time == c->time && r->seq < c->seq)) {
+                child++;
+                c = r;
+            }
+        }
+        if (last.time < c->time || (last.time == c->time && last.seq < c->seq)) {
+            break;
+        }
+        sim->events[i] = *c;
+        i = child;
+    }
+    sim->events[i] = last;
+    return top;
+}
+
+/* Take a pool slot; returns -1 if the bakery is saturated */
+int alloc_customer(SimState* sim) {
+    int slot = sim->free_head;
+    if (slot != -1) {
+        sim->free_head = sim->pool[slot].next_free;
+        sim->inflight++;
+    }
+    return slot;
+}
+
+/* Return a pool slot to the free list */
+void free_customer(SimState* sim, int slot) {
+    sim->pool[slot].next_free = sim->free_head;
+    sim->free_head = slot;
+    sim->inflight--;
+}
+
+/*
+ * Check if a customer of given color can walk straight in based on the
+ * balance rule: their color may end up at most tolerance ahead (tolerance
+ * 0 admits only the color that is behind)
+ */
+bool can_enter(SimState* sim, CustomerColor color) {
+    if (sim->customers_inside == 0) {
+        return true;
+    }
+    int own = color == RED ? sim->red_count : sim->blue_count;
+    int other = color == RED ? sim->blue_count : sim->red_count;
+    return own + 1 - other <= sim->params.tolerance;
+}
+
+/* Whether the head of a color's line may be let in: one more than can_enter allows */
+static bool can_admit_from_line(SimState* sim, CustomerColor color) {
+    int own = color == RED ? sim->red_count : sim->blue_count;
+    int other = color == RED ? sim->blue_count : sim->red_count;
+    return sim->queues[color].size > 0 && own - other <= sim->params.tolerance;
+}
+
+/* Admit a customer to a table and schedule their departure */
+void seat_customer(SimState* sim, int slot) {
+    SimCustomer* c = &sim->pool[slot];
+    int64_t wait = sim->now - c->arrival_time;
+
+    if (c->color == RED) {
+        sim->red_count++;
+    } else {
+        sim->blue_count++;
+    }
+    sim->customers_inside++;
+    sim->free_tables--;
+    sim->timeline.tiers[0].current.admissions++;
+
+    sim->total_wait += wait;
+    if (wait > sim->max_wait) {
+        sim->max_wait = wait;
+    }
+    int bucket = (int)(8.0 * log2(1.0 + wait / 1000.0));
+    sim->wait_hist[bucket < WAIT_BUCKETS ? bucket : WAIT_BUCKETS - 1]++;
+    sim->total_eating += c->eating_time;
+    push_event(sim, sim->now + c->eating_time, EV_DEPART, slot);
+}
+
+/* Let waiting customers in while tables are free and balance allows it */
+void try_balance_entry(SimState* sim) {
+    while (sim->free_tables > 0) {
+        SimQueue* red = &sim->queues[RED];
+        SimQueue* blue = &sim->queues[BLUE];
+        SimQueue* q = NULL;
+        bool red_ok = can_admit_from_line(sim, RED);
+        bool blue_ok = can_admit_from_line(sim, BLUE);
+
+        if (red_ok && blue_ok) {
+            // The color that is behind goes first; when balanced, the longer line
+            if (sim->red_count != sim->blue_count) {
+                q = sim->red_count < sim->blue_count ? red : blue;
+            } else {
+                q = red->size >= blue->size ? red : blue;
+            }
+        } else if (red_ok) {
+            q = red;
+        } else if (blue_ok) {
+            q = blue;
+        } else {
+            break;
+        }
+
+        int slot = q->slots[q->front];
+        q->front = (q->front + 1) % MAX_INFLIGHT;
+        q->size--;
+        seat_customer(sim, slot);
+    }
+}
+
+/* A new customer arrives; seat them or put them in line */
+void handle_arrival(SimState* sim) {
+    int slot = alloc_customer(sim);
+    if (slot == -1) {
+        sim->rejected++;
+    } else {
+        SimCustomer* c = &sim->pool[slot];
+        double eat = sim->params.eat_min_s +
+                     rng_uniform(&sim->rng[STREAM_EATING]) * (sim->params.eat_max_s - sim->params.eat_min_s);
+
+        sim->timeline.tiers[0].current.arrivals++;
+        c->id = sim->customers_generated + 1;
+        c->color = (rng_next(&sim->rng[STREAM_COLORS]) >> 63) ? BLUE : RED;
+        c->arrival_time = sim->now;
+        c->eating_time = (int64_t)(eat * US_PER_SECOND);
+
+        if (sim->free_tables > 0 && can_enter(sim, c->color)) {
+            seat_customer(sim, slot);
+        } else {
+            SimQueue* q = &sim->queues[c->color];
+            q->slots[(q->front + q->size) % MAX_INFLIGHT] = slot;
+            q->size++;
+            sim->queued++;
+        }
+    }
+
+    // Schedule the next arrival (exponential inter-arrival time)
+    sim->customers_generated++;
+    if (sim->customers_generated < sim->params.total_customers) {
+        double gap_ms = -sim->params.arrival_mean_ms * log1p(-rng_uniform(&sim->rng[STREAM_ARRIVALS]));
+        push_event(sim, sim->now + (int64_t)(gap_ms * 1000.0), EV_ARRIVAL, -1);
+    }
+}
+
+/* A seated customer leaves, freeing a table */
+void handle_departure(SimState* sim, int slot) {
+    SimCustomer* c = &sim->pool[slot];
+
+    if (c->color == RED) {
+        sim->red_count--;
+    } else {
+        sim->blue_count--;
+    }
+    sim->customers_inside--;
+    sim->free_tables++;
+    sim->served[c->color]++;
+
+    if (records != NULL) {
+        int64_t i = records->count++;
+        records->arrival[i] = c->arrival_time;
+        records->seat[i] = sim->now - c->eating_time;
+        records->leave[i] = sim->now;
+        records->color[i] = (uint8_t)c->color;
+        if (records->count == RECORD_BLOCK) {
+            flush_records(records);
+        }
+    }
+    free_customer(sim, slot);
+
+    try_balance_entry(sim);
+}
+
+/* Start every tier with an empty bucket at time zero */
+void timeline_init(Timeline* tl) {
+    static const int64_t widths[TIMELINE_TIERS] = {
+        US_PER_SECOND, 60 * US_PER_SECOND, 3600 * US_PER_SECOND
+    };
+    memset(tl, 0, sizeof(*tl));
+    for (int t = 0; t < TIMELINE_TIERS; t++) {
+        tl->tiers[t].width = widths[t];
+    }
+}
+
+/* Move a tier's filled bucket into its ring and roll it up into the next tier */
+static void timeline_close(Timeline* tl, int tier) {
+    TimelineTier* t = &tl->tiers[tier];
+    TimeBucket* done = &t->current;
+
+    // Ring is full: overwrite the oldest bucket
+    if (t->count == TIMELINE_SLOTS) {
+        t->head = (t->head + 1) % TIMELINE_SLOTS;
+        t->count--;
+    }
+    t->ring[(t->head + t->count) % TIMELINE_SLOTS] = *done;
+    t->count++;
+
+    if (tier + 1 < TIMELINE_TIERS) {
+        TimelineTier* up = &tl->tiers[tier + 1];
+        TimeBucket* into = &up->current;
+        into->occupancy_area += done->occupancy_area;
+        into->queue_area += done->queue_area;
+        into->arrivals += done->arrivals;
+        into->admissions += done->admissions;
+        if (done->max_occupancy > into->max_occupancy) {
+            into->max_occupancy = done->max_occupancy;
+        }
+        if (done->max_queue > into->max_queue) {
+            into->max_queue = done->max_queue;
+        }
+        if (done->start + t->width >= into->start + up->width) {
+            timeline_close(tl, tier + 1);
+        }
+    }
+
+    // Open the next bucket at the levels currently in effect
+    int64_t next = done->start + t->width;
+    memset(done, 0, sizeof(*done));
+    done->start = next;
+    done->max_occupancy = tl->occupancy;
+    done->max_queue = tl->queue;
+}
+
+/* Integrate the current levels up to now, closing finished 1 s buckets */
+void timeline_advance(Timeline* tl, int64_t now) {
+    TimelineTier* fine = &tl->tiers[0];
+
+    while (now >= fine->current.start + fine->width) {
+        int64_t end = fine->current.start + fine->width;
+        fine->current.occupancy_area += (int64_t)tl->occupancy * (end - tl->last_update);
+        fine->current.queue_area += (int64_t)tl->queue * (end - tl->last_update);
+        tl->last_update = end;
+        timeline_close(tl, 0);
+    }
+    fine->current.occupancy_area += (int64_t)tl->occupancy * (now - tl->last_update);
+    fine->current.queue_area += (int64_t)tl->queue * (now - tl->last_update);
+    tl->last_update = now;
+}
+
+/* Record the levels after an event changed them */
+void timeline_observe(Timeline* tl, int occupancy, int queue) {
+    TimeBucket* b = &tl->tiers[0].current;
+    tl->occupancy = occupancy;
+    tl->queue = queue;
+    if (occupancy > b->max_occupancy) {
+        b->max_occupancy = occupancy;
+    }
+    if (queue > b->max_queue) {
+        b->max_queue = queue;
+    }
+}
+
+/* Write one bucket as a CSV row; partial buckets average over their elapsed part */
+static void write_bucket(FILE* f, int tier, const TimeBucket* b, int64_t span) {
+    if (span <= 0) {
+        return;
+    }
+    fprintf(f, "%d,%.0f,%.0f,%.3f,%d,%.3f,%d,%d,%d\n", tier,
+            span / (double)US_PER_SECOND, b->start / (double)US_PER_SECOND,
+            b->occupancy_area / (double)span, b->max_occupancy,
+            b->queue_area / (double)span, b->max_queue, b->arrivals, b->admissions);
+}
+
+/* Dump every retained bucket of every tier as CSV */
+int save_timeline(const Timeline* tl, const char* path) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        perror("Error opening timeline file");
+        return -1;
+    }
+    fprintf(f, "tier,width_s,start_s,avg_occupancy,max_occupancy,avg_queue,max_queue,arrivals,admissions\n");
+    for (int t = 0; t < TIMELINE_TIERS; t++) {
+        const TimelineTier* tier = &tl->tiers[t];
+        for (int i = 0; i < tier->count; i++) {
+            write_bucket(f, t, &tier->ring[(tier->head + i) % TIMELINE_SLOTS], tier->width);
+        }
+        write_bucket(f, t, &tier->current, tl->last_update - tier->current.start);
+    }
+    if (fclose(f) != 0) {
+        perror("Error writing timeline file");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Process events until the event set is empty, stop_after_events events
+ * have been processed in total (0 = no limit), or the run is interrupted.
+ * Returns true if the run finished.
+ */
+bool run_sim(SimState* sim, long stop_after_events) {
+    while (sim->event_count > 0) {
+        if (interrupted || (stop_after_events > 0 && sim->events_processed >= stop_after_events)) {
+            return false;
+        }
+
+        Event ev = pop_event(sim);
+        sim->now = ev.time;
+        sim->events_processed++;
+        timeline_advance(&sim->timeline, sim->now);
+
+        if (ev.type == EV_ARRIVAL) {
+            handle_arrival(sim);
+        } else {
+            handle_departure(sim, ev.customer);
+        }
+
+        timeline_observe(&sim->timeline, sim->customers_inside,
+                         sim->queues[RED].size + sim->queues[BLUE].size);
+    }
+    return true;
+}
+
+/* Write a snapshot atomically (temp file + rename); returns 0 on success */
+int save_snapshot(const SimState* sim, const char* path) {
+    char tmp_path[4096];
+    SnapshotHeader header;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.header_size = sizeof(SnapshotHeader);
+    header.state_size = sizeof(SimState);
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        perror("Error opening snapshot file");
+        return -1;
+    }
+    if (fwrite(&header, sizeof(header), 1, f) != 1 || fwrite(sim, sizeof(*sim), 1, f) != 1) {
+        perror("Error writing snapshot");
+        fclose(f);
+        unlink(tmp_path);
+        return -1;
+    }
+    if (fclose(f) != 0 || rename(tmp_path, path) != 0) {
+        perror("Error saving snapshot");
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Map a snapshot copy-on-write and return its state in place.
+ * Nothing is parsed or copied; pages fault in as the simulation touches them.
+ */
+SimState* map_snapshot(const char* path, size_t* mapped_size) {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening snapshot");
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size != sizeof(SnapshotHeader) + sizeof(SimState)) {
+        fprintf(stderr, "Snapshot %s has the wrong size for this build.\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error mapping snapshot");
+        return NULL;
+    }
+
+    SnapshotHeader* header = (SnapshotHeader*)map;
+    if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION ||
+        header->header_size != sizeof(SnapshotHeader) || header->state_size != sizeof(SimState)) {
+        fprintf(stderr, "Snapshot %s is not compatible with this build.\n", path);
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    *mapped_size = st.st_size;
+    return (SimState*)((char*)map + sizeof(SnapshotHeader));
+}
+
+/* Create a record file and its block buffer */
+RecordWriter* open_records(const char* path) {
+    RecordFileHeader header = { RECORD_MAGIC, RECORD_BLOCK };
+    RecordWriter* writer = malloc(sizeof(RecordWriter));
+    if (writer == NULL) {
+        perror("Error allocating record buffer");
+        return NULL;
+    }
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL || fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+        perror("Error opening record file");
+        if (writer->file != NULL) {
+            fclose(writer->file);
+        }
+        free(writer);
+        return NULL;
+    }
+    writer->count = 0;
+    return writer;
+}
+
+/* Write the buffered records as one columnar block */
+void flush_records(RecordWriter* writer) {
+    static const uint8_t padding[8] = { 0 };
+    int64_t n = writer->count;
+    if (n == 0) {
+        return;
+    }
+    fwrite(&n, sizeof(n), 1, writer->file);
+    fwrite(writer->arrival, sizeof(int64_t), n, writer->file);
+    fwrite(writer->seat, sizeof(int64_t), n, writer->file);
+    fwrite(writer->leave, sizeof(int64_t), n, writer->file);
+    fwrite(writer->color, 1, n, writer->file);
+    fwrite(padding, 1, (8 - n % 8) % 8, writer->file);
+    writer->count = 0;
+}
+
+/* Flush the last partial block and close the file */
+void close_records(RecordWriter* writer) {
+    flush_records(writer);
+    if (fclose(writer->file) != 0) {
+        perror("Error writing record file");
+    }
+    free(writer);
+}
+
+/* Print end-of-run statistics */
+void print_summary(const SimState* sim, double wall_seconds) {
+    long served = sim->served[RED] + sim->served[BLUE];
+
+    printf("Virtual time: %.1f s, events: %ld, wall time: %.3f s\n",
+           sim->now / (double)US_PER_SECOND, sim->events_processed, wall_seconds);
+    printf("Summary:\n");
+    printf("- Red customers served: %ld\n", sim->served[RED]);
+    printf("- Blue customers served: %ld\n", sim->served[BLUE]);
+    printf("- Total customers: %ld\n", served);
+    printf("- Had to queue: %ld, turned away: %ld\n", sim->queued, sim->rejected);
+    printf("- Average wait: %.3f s, p99 wait: %.3f s, max wait: %.3f s\n",
+           served ? sim->total_wait / (double)served / US_PER_SECOND : 0.0,
+           wait_percentile(sim, 0.99), sim->max_wait / (double)US_PER_SECOND);
+}
+
+/* Upper bound (seconds) of the wait histogram bucket holding quantile q */
+double wait_percentile(const SimState* sim, double q) {
+    int64_t total = 0;
+    for (int i = 0; i < WAIT_BUCKETS; i++) {
+        total += sim->wait_hist[i];
+    }
+    int64_t rank = (int64_t)(q * total);
+    int64_t seen = 0;
+    for (int i = 0; i < WAIT_BUCKETS; i++) {
+        seen += sim->wait_hist[i];
+        if (seen > rank) {
+            return (exp2((i + 1) / 8.0) - 1.0) / 1000.0;
+        }
+    }
+    return 0.0;
+}
+
+/* Erlang C: probability that an arrival waits in an M/M/servers queue with the given offered load */
+static double erlang_c(int servers, double offered) {
+    double b = 1.0;              // Erlang B by the stable recurrence
+    for (int k = 1; k <= servers; k++) {
+        b = offered * b / (k + offered * b);
+    }
+    double rho = offered / servers;
+    return b / (1.0 - rho * (1.0 - b));
+}
+
+/*
+ * M/G/c queue wait with the Allen-Cunneen correction for non-exponential
+ * service (squared coefficient of variation cs2). Sets *p_wait to the
+ * probability of waiting at all and returns the mean wait in seconds.
+ */
+static double mgc_wait(int servers, double lambda, double service_s, double cs2, double* p_wait) {
+    double c = erlang_c(servers, lambda * service_s);
+    *p_wait = c;
+    return c / (servers / service_s - lambda) * (1.0 + cs2) / 2.0;
+}
+
+/*
+ * Steady-state estimate for the balanced two-class system.
+ *
+ * The admission rule splits the bakery in two: while both lines are busy
+ * a table freed by one color can only be refilled by that color, so each
+ * color behaves like an M/G/(c/2) queue fed at half the arrival rate (odd
+ * table counts interpolate between floor and ceil at the same per-table
+ * utilization). On top of that, an arrival that finds
+ * the room balanced (or its own color ahead) is gated even with tables
+ * free; it waits roughly one mean residual eating time, E[S^2] / 2E[S],
+ * for the departure that tips the balance its way. The chance of being
+ * gated is modelled as 3/4 of a non-empty room, with the number inside
+ * taken as Poisson (M/G/inf) with mean lambda * E[S]. One table is simply
+ * M/G/1. The model is for the strict rule (tolerance 0); looser
+ * tolerances gate fewer arrivals, so it overestimates their waits.
+ */
+Estimate estimate_queue(const SimParams* params) {
+    Estimate est = { false, 0.0, 0.0, INFINITY, INFINITY };
+    double lambda = 1000.0 / params->arrival_mean_ms;
+    double mean_s = (params->eat_min_s + params->eat_max_s) / 2.0;
+    double spread = params->eat_max_s - params->eat_min_s;
+    double cs2 = mean_s > 0.0 ? spread * spread / 12.0 / (mean_s * mean_s) : 0.0;
+    int c = params->tables;
+
+    est.utilization = lambda * mean_s / c;
+    if (est.utilization >= 1.0) {
+        est.utilization = 1.0;
+        est.p_queue = 1.0;
+        return est;              // Lines grow without bound
+    }
+    est.stable = true;
+    if (mean_s <= 0.0) {
+        est.mean_wait_s = est.p99_wait_s = 0.0;
+        return est;
+    }
+
+    double gated = 0.0, gate_s = 0.0, full = 0.0, full_s = 0.0;
+    if (c == 1) {
+        full_s = mgc_wait(1, lambda, mean_s, cs2, &full);
+    } else {
+        // Per-color tables at the bakery's utilization; odd counts average floor and ceil
+        int lo = c / 2, hi = (c + 1) / 2;
+        double p_lo, p_hi;
+        double w_lo = mgc_wait(lo, est.utilization * lo / mean_s, mean_s, cs2, &p_lo);
+        double w_hi = mgc_wait(hi, est.utilization * hi / mean_s, mean_s, cs2, &p_hi);
+        full_s = (w_lo + w_hi) / 2.0;
+        full = (p_lo + p_hi) / 2.0;
+
+        gated = 0.75 * (1.0 - exp(-lambda * mean_s));
+        gate_s = mean_s * (1.0 + cs2) / 2.0;
+    }
+
+    est.p_queue = 1.0 - (1.0 - gated) * (1.0 - full);
+    est.mean_wait_s = gated * gate_s + full_s;
+
+    // Tail: exponential gate wait plus an exponential line wait for those who queue
+    double line_s = full > 0.0 ? full_s / full : 0.0;
+    double lo_t = 0.0, hi_t = 1.0;
+    while (gated * exp(-hi_t / fmax(gate_s, 1e-9)) + full * exp(-hi_t / fmax(line_s, 1e-9)) > 0.01) {
+        hi_t *= 2.0;
+    }
+    for (int i = 0; i < 60; i++) {
+        double t = (lo_t + hi_t) / 2.0;
+        double tail = gated * exp(-t / fmax(gate_s, 1e-9)) + full * exp(-t / fmax(line_s, 1e-9));
+        if (tail > 0.01) {
+            lo_t = t;
+        } else {
+            hi_t = t;
+        }
+    }
+    est.p99_wait_s = hi_t;
+    return est;
+}
+
+/* Print an estimate, and its divergence from a finished simulation if sim is not NULL */
+void print_estimate(const Estimate* est, double compute_us, const SimState* sim) {
+    printf("Analytic estimate (%.1f us):\n", compute_us);
+    if (!est->stable) {
+        printf("- Unstable: offered load exceeds the tables, lines grow without bound\n");
+    }
+    if (sim == NULL) {
+        printf("- Utilization: %.1f%%\n", 100.0 * est->utilization);
+        printf("- Had to queue: %.1f%%\n", 100.0 * est->p_queue);
+        printf("- Average wait: %.3f s, p99 wait: %.3f s\n", est->mean_wait_s, est->p99_wait_s);
+        return;
+    }
+
+    long served = sim->served[RED] + sim->served[BLUE];
+    double sim_util = sim->now > 0 ? (double)sim->total_eating / ((double)sim->now * sim->params.tables) : 0.0;
+    double sim_queue = sim->customers_generated > 0 ? (double)sim->queued / sim->customers_generated : 0.0;
+    double sim_mean = served ? sim->total_wait / (double)served / US_PER_SECOND : 0.0;
+    double sim_p99 = wait_percentile(sim, 0.99);
+    double est_values[4] = { est->utilization, est->p_queue, est->mean_wait_s, est->p99_wait_s };
+    double sim_values[4] = { sim_util, sim_queue, sim_mean, sim_p99 };
+    const char* names[4] = { "utilization", "had to queue", "average wait s", "p99 wait s" };
+
+    printf("%-16s %12s %12s %10s\n", "", "estimate", "simulated", "error");
+    for (int i = 0; i < 4; i++) {
+        printf("%-16s %12.3f %12.3f", names[i], est_values[i], sim_values[i]);
+        if (sim_values[i] > 0.0 && isfinite(est_values[i])) {
+            printf(" %+9.1f%%\n", 100.0 * (est_values[i] - sim_values[i]) / sim_values[i]);
+        } else {
+            printf(" %10s\n", "-");
+        }
+    }
+}
+
+/* Zero the statistics so a trial measures only what happens after its warm-up */
+static void reset_stats(SimState* sim) {
+    sim->served[RED] = sim->served[BLUE] = 0;
+    sim->queued = 0;
+    sim->rejected = 0;
+    sim->total_wait = 0;
+    sim->max_wait = 0;
+    sim->total_eating = 0;
+    memset(sim->wait_hist, 0, sizeof(sim->wait_hist));
+}
+
+/* Change the table count of a running simulation, seating whoever now fits */
+static void set_tables(SimState* sim, int tables) {
+    sim->free_tables += tables - sim->params.tables;
+    sim->params.tables = tables;
+    try_balance_entry(sim);
+}
+
+/*
+ * Evaluate count trials in parallel. Every child forks from the same warmed
+ * state (shared copy-on-write), switches to its table count, clears the
+ * statistics and runs the measurement window; results come back through a
+ * shared anonymous mapping.
+ */
+static void run_trials(SimState* warm, TuneTrial* trials, int count) {
+    TuneTrial* shared = mmap(NULL, sizeof(TuneTrial) * count, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("Error mapping trial results");
+        exit(1);
+    }
+    memcpy(shared, trials, sizeof(TuneTrial) * count);
+    fflush(stdout);
+
+    for (int i = 0; i < count; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("Error forking trial");
+            exit(1);
+        }
+        if (pid == 0) {
+            set_tables(warm, shared[i].tables);
+            reset_stats(warm);
+            run_sim(warm, 0);
+            long served = warm->served[RED] + warm->served[BLUE];
+            shared[i].p99_wait_s = wait_percentile(warm, 0.99);
+            shared[i].mean_wait_s = served ? warm->total_wait / (double)served / US_PER_SECOND : 0.0;
+            shared[i].rejected = warm->rejected;
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+    memcpy(trials, shared, sizeof(TuneTrial) * count);
+    munmap(shared, sizeof(TuneTrial) * count);
+}
+
+/* A trial meets the SLO if nobody was turned away and p99 wait is within it */
+static bool meets_slo(const TuneTrial* trial, double slo_s) {
+    return trial->rejected == 0 && trial->p99_wait_s <= slo_s;
+}
+
+/*
+ * Smallest table count meeting the SLO for one admission tolerance.
+ * Counts at or below the offered load are unstable and never tried. The
+ * analytic estimate gives the first guess; each round then evaluates up to
+ * jobs counts in parallel, first growing geometrically until one passes,
+ * then splitting the bracket (lo fails, hi passes) into jobs + 1 parts.
+ * Assumes p99 wait does not grow with more tables, which holds for the
+ * common random numbers every trial shares. Returns 0 if max_tables fails.
+ */
+static int tune_tolerance(const SimParams* base, double slo_s, int max_tables, int jobs,
+                          TuneTrial* best, int* trial_count) {
+    double offered = 1000.0 / base->arrival_mean_ms * (base->eat_min_s + base->eat_max_s) / 2.0;
+    int lo = (int)offered;       // Known to fail (unstable)
+    int hi = 0;                  // Smallest count known to pass
+
+    int guess = lo + 1;
+    SimParams probe = *base;
+    for (probe.tables = lo + 1; probe.tables <= max_tables; probe.tables++) {
+        if (estimate_queue(&probe).p99_wait_s <= slo_s) {
+            guess = probe.tables;
+            break;
+        }
+    }
+    if (guess > max_tables) {
+        guess = max_tables;
+    }
+
+    // One warm-up per tolerance; every trial of the search starts from it
+    SimParams params = *base;
+    params.tables = guess;
+    long warmup = base->total_customers / 10 > 1000 ? base->total_customers / 10 : 1000;
+    params.total_customers = warmup + base->total_customers;
+    SimState* warm = malloc(sizeof(SimState));
+    if (warm == NULL) {
+        perror("Error allocating simulation state");
+        exit(1);
+    }
+    init_sim(warm, &params);
+    run_sim(warm, 2 * warmup);
+
+    TuneTrial trials[MAX_TUNE_JOBS];
+    int next = guess;
+    while (hi == 0 || hi - lo > 1) {
+        int count = 0;
+        if (hi == 0) {
+            // No passing count yet: probe upwards from the guess, growing by a quarter each step
+            for (int t = next; count < jobs && t <= max_tables; t += t / 4 > 1 ? t / 4 : 1) {
+                trials[count++].tables = t;
+            }
+            if (count == 0) {
+                break;           // Even max_tables fails
+            }
+        } else {
+            for (int i = 1; i <= jobs; i++) {
+                int t = lo + (int)((long)(hi - lo) * i / (jobs + 1));
+                if (t > lo && t < hi && (count == 0 || t != trials[count - 1].tables)) {
+                    trials[count++].tables = t;
+                }
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            trials[i].tolerance = base->tolerance;
+        }
+        run_trials(warm, trials, count);
+        *trial_count += count;
+
+        for (int i = 0; i < count; i++) {
+            if (meets_slo(&trials[i], slo_s)) {
+                if (hi == 0 || trials[i].tables < hi) {
+                    hi = trials[i].tables;
+                    *best = trials[i];
+                }
+            } else if (trials[i].tables > lo && (hi == 0 || trials[i].tables < hi)) {
+                lo = trials[i].tables;
+            }
+        }
+        if (hi == 0) {
+            int last = trials[count - 1].tables;
+            next = last + (last / 4 > 1 ? last / 4 : 1);
+            if (last >= max_tables) {
+                break;
+            }
+            if (next > max_tables) {
+                next = max_tables;
+            }
+        }
+    }
+    free(warm);
+    return hi;
+}
+
+/* Auto-tuner: cheapest (tables, tolerance) whose simulated p99 wait meets the SLO */
+int auto_tune(const SimParams* base, double slo_s, int max_tables, int jobs) {
+    printf("Tuning for p99 wait <= %.3f s: mean arrival %.1f ms, eating %.1f-%.1f s, "
+           "%ld measured customers per trial, %d parallel trials\n",
+           slo_s, base->arrival_mean_ms, base->eat_min_s, base->eat_max_s, base->total_customers, jobs);
+    printf("%-10s %8s %12s %12s %8s\n", "tolerance", "tables", "p99 wait s", "mean wait s", "trials");
+
+    int best_tables = 0;
+    int best_tolerance = 0;
+    for (int tolerance = 0; tolerance <= MAX_TUNE_TOLERANCE; tolerance++) {
+        SimParams params = *base;
+        params.tolerance = tolerance;
+        TuneTrial best = { 0, tolerance, 0.0, 0.0, 0 };
+        int trials = 0;
+        int tables = tune_tolerance(&params, slo_s, max_tables, jobs, &best, &trials);
+        if (tables == 0) {
+            printf("%-10d %8s %12s %12s %8d\n", tolerance, "-", "-", "-", trials);
+            continue;
+        }
+        printf("%-10d %8d %12.3f %12.3f %8d\n", tolerance, tables, best.p99_wait_s, best.mean_wait_s, trials);
+        if (best_tables == 0 || tables < best_tables) {
+            best_tables = tables;
+            best_tolerance = tolerance;
+        }
+    }
+
+    if (best_tables == 0) {
+        printf("No configuration up to %d tables meets the SLO.\n", max_tables);
+        return 1;
+    }
+    printf("Cheapest: %d tables with tolerance %d\n", best_tables, best_tolerance);
+    return 0;
+}
+
+static void on_interrupt(int sig) {
+    (void)sig;
+    interrupted = 1;
+}
+
+static double wall_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --tables N            Number of tables (default 5)\n"
+        "  --customers N         Customers to simulate (default 1000000)\n"
+        "  --arrival-ms X        Mean inter-arrival time in ms (default 500)\n"
+        "  --eat-min S           Minimum eating time in seconds (default 1)\n"
+        "  --eat-max S           Maximum eating time in seconds (default 5)\n"
+        "  --seed N              RNG seed (default 1)\n"
+        "  --checkpoint FILE     Snapshot file written at --checkpoint-at and on Ctrl-C\n"
+        "  --checkpoint-at N     Event count at which to write the snapshot\n"
+        "  --restore FILE        Continue from a snapshot (--tables/--seed override it)\n"
+        "  --fork K              After restoring, run K what-if children (seed+0..K-1)\n"
+        "  --records FILE        Write completed-customer records for src_stats\n"
+        "  --timeline FILE       Write the occupancy/queue timeline as CSV\n"
+        "  --estimate            Also print the analytic estimate and its error\n"
+        "  --estimate-only       Print the analytic estimate without simulating\n"
+        "  --tolerance K         Let a color get up to K ahead when admitting (default 0)\n"
+        "  --tune-p99 S          Find the fewest tables (and tolerance) with p99 wait <= S s\n"
+        "  --tune-max-tables N   Largest table count the tuner tries (default 1000)\n"
+        "  --tune-jobs N         Parallel trials (default: online CPUs)\n",
+        prog);
+}
+
+/* Main function - command line driver */
+int main(int argc, char* argv[]) {
+    SimParams params = { 5, 1000000, 500.0, 1.0, 5.0, 1, 0 };
+    const char* checkpoint_path = NULL;
+    const char* restore_path = NULL;
+    const char* records_path = NULL;
+    const char* timeline_path = NULL;
+    long checkpoint_at = 0;
+    int forks = 0;
+    int tables_override = 0;
+    bool seed_override = false;
+    bool estimate = false;
+    bool estimate_only = false;
+    double tune_slo = 0.0;
+    int tune_max_tables = 1000;
+    int tune_jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--estimate") == 0) {
+            estimate = true;
+            continue;
+        }
+        if (strcmp(arg, "--estimate-only") == 0) {
+            estimate_only = true;
+            continue;
+        }
+        if (val == NULL) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(arg, "--tables") == 0) {
+            params.tables = tables_override = atoi(val);
+        } else if (strcmp(arg, "--customers") == 0) {
+            params.total_customers = atol(val);
+        } else if (strcmp(arg, "--arrival-ms") == 0) {
+            params.arrival_mean_ms = atof(val);
+        } else if (strcmp(arg, "--eat-min") == 0) {
+            params.eat_min_s = atof(val);
+        } else if (strcmp(arg, "--eat-max") == 0) {
+            params.eat_max_s = atof(val);
+        } else if (strcmp(arg, "--seed") == 0) {
+            params.seed = strtoull(val, NULL, 10);
+            seed_override = true;
+        } else if (strcmp(arg, "--checkpoint") == 0) {
+            checkpoint_path = val;
+        } else if (strcmp(arg, "--checkpoint-at") == 0) {
+            checkpoint_at = atol(val);
+        } else if (strcmp(arg, "--restore") == 0) {
+            restore_path = val;
+        } else if (strcmp(arg, "--records") == 0) {
+            records_path = val;
+        } else if (strcmp(arg, "--timeline") == 0) {
+            timeline_path = val;
+        } else if (strcmp(arg, "--fork") == 0) {
+            forks = atoi(val);
+        } else if (strcmp(arg, "--tolerance") == 0) {
+            params.tolerance = atoi(val);
+        } else if (strcmp(arg, "--tune-p99") == 0) {
+            tune_slo = atof(val);
+        } else if (strcmp(arg, "--tune-max-tables") == 0) {
+            tune_max_tables = atoi(val);
+        } else if (strcmp(arg, "--tune-jobs") == 0) {
+            tune_jobs = atoi(val);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    if (params.tables <= 0 || params.total_customers < 0 || params.arrival_mean_ms <= 0 ||
+        params.eat_min_s < 0 || params.eat_max_s < params.eat_min_s || params.tolerance < 0) {
+        fprintf(stderr, "Invalid simulation parameters.\n");
+        return 1;
+    }
+
+    if (tune_slo > 0.0) {
+        if (tune_jobs < 1) {
+            tune_jobs = 1;
+        }
+        if (tune_jobs > MAX_TUNE_JOBS) {
+            tune_jobs = MAX_TUNE_JOBS;
+        }
+        return auto_tune(&params, tune_slo, tune_max_tables, tune_jobs);
+    }
+
+    if (estimate_only) {
+        double t0 = wall_clock();
+        Estimate est = estimate_queue(&params);
+        double compute_us = (wall_clock() - t0) * 1e6;
+        print_estimate(&est, compute_us, NULL);
+        return 0;
+    }
+
+    signal(SIGINT, on_interrupt);
+    double start = wall_clock();
+    SimState* sim;
+    size_t mapped_size = 0;
+
+    if (restore_path != NULL) {
+        sim = map_snapshot(restore_path, &mapped_size);
+        if (sim == NULL) {
+            return 1;
+        }
+        printf("Restored %s at virtual time %.1f s (%ld events) in %.3f ms\n",
+               restore_path, sim->now / (double)US_PER_SECOND, sim->events_processed,
+               (wall_clock() - start) * 1000.0);
+
+        // What-if overrides applied on top of the restored state
+        if (tables_override > 0) {
+            set_tables(sim, tables_override);
+        }
+        if (seed_override) {
+            sim->params.seed = params.seed;
+            seed_streams(sim, params.seed);
+        }
+    } else {
+        sim = malloc(sizeof(SimState));
+        if (sim == NULL) {
+            perror("Error allocating simulation state");
+            return 1;
+        }
+        init_sim(sim, &params);
+    }
+
+    if (forks > 0) {
+        // Every child shares the mapped snapshot copy-on-write and diverges by seed.
+        // Flush first, or each child re-emits whatever output is still buffered.
+        fflush(stdout);
+        fflush(stderr);
+        for (int k = 0; k < forks; k++) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("Error forking what-if run");
+                break;
+            }
+            if (pid == 0) {
+                seed_streams(sim, sim->params.seed + k);
+                double child_start = wall_clock();
+                run_sim(sim, 0);
+                printf("\n--- What-if %d (seed %llu, %d tables) ---\n", k,
+                       (unsigned long long)(sim->params.seed + k), sim->params.tables);
+                print_summary(sim, wall_clock() - child_start);
+                fflush(stdout);
+                _exit(0);
+            }
+        }
+        while (wait(NULL) > 0) {
+        }
+        return 0;
+    }
+
+    if (records_path != NULL) {
+        records = open_records(records_path);
+        if (records == NULL) {
+            return 1;
+        }
+    }
+
+    bool finished;
+    if (checkpoint_path != NULL && checkpoint_at > sim->events_processed) {
+        finished = run_sim(sim, checkpoint_at);
+        if (!finished && !interrupted) {
+            if (save_snapshot(sim, checkpoint_path) == 0) {
+                printf("Checkpoint written to %s at virtual time %.1f s\n",
+                       checkpoint_path, sim->now / (double)US_PER_SECOND);
+            }
+            finished = run_sim(sim, 0);
+        }
+    } else {
+        finished = run_sim(sim, 0);
+    }
+
+    if (!finished) {
+        // Interrupted: save progress so the run can resume from here
+        if (checkpoint_path != NULL && save_snapshot(sim, checkpoint_path) == 0) {
+            printf("\nInterrupted; state saved to %s\n", checkpoint_path);
+        } else {
+            printf("\nInterrupted.\n");
+        }
+    }
+
+    print_summary(sim, wall_clock() - start);
+
+    if (estimate) {
+        double t0 = wall_clock();
+        Estimate est = estimate_queue(&sim->params);
+        double compute_us = (wall_clock() - t0) * 1e6;
+        print_estimate(&est, compute_us, sim);
+    }
+
+    if (records != NULL) {
+        close_records(records);
+    }
+    if (timeline_path != NULL && save_timeline(&sim->timeline, timeline_path) == 0) {
+        printf("Timeline written to %s\n", timeline_path);
+    }
+    if (mapped_size > 0) {
+        munmap((char*)sim - sizeof(SnapshotHeader), mapped_size);
+    } else {
+        free(sim);
+    }
+    printf("Sweet Harmony bakery is now closed.\n");
+    return 0;
+}
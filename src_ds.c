@@ -7,6 +7,69 @@
  * 2. Limited tables must be managed
  * 3. Customer queues must be handled
  * 4. Entry/exit operations must be synchronized
+ *
+ * While the simulation runs, a metrics snapshot (occupancy, queue depths,
+ * throughput, queue-wait percentiles) is served on a local Unix socket.
+ * Scrape it with e.g. `nc -U /tmp/sweet_harmony.sock < /dev/null`, or send
+ * "json" for a JSON document instead of Prometheus text.
+ *
+ * Each color waits in its own lane. Walk-ins form an intrusive FIFO list;
+ * VIP and reservation customers go to a 4-ary heap (nodes in one pooled
+ * array) ordered by priority and then by seat-by deadline, and are let in
+ * ahead of walk-ins of their color. The balance rule still decides which
+ * color goes next; when either may, the more urgent head of line wins.
+ * Each admitted customer is handed its own wake-up, so exactly the chosen
+ * customer enters. `./src_ds --queue-bench [N]` times the lanes with N
+ * customers waiting.
+ *
+ * Customers are not infinitely patient. On arrival a customer balks if
+ * the line of their color is already as long as they will tolerate, and
+ * a queued customer waits with sem_timedwait() only for their patience
+ * (BAKERY_PATIENCE seconds on average, default 8). When it runs out they
+ * unlink themselves from the middle of the lane (O(1) for walk-ins,
+ * O(log n) for the heap) under the bakery lock and leave; a customer
+ * admitted in the same instant finds they are no longer in the lane and
+ * goes in instead. Balks and reneges are events of their own, reported
+ * by the stats sink and the metrics server as the abandonment rate.
+ *
+ * bakery_mutex guards only a few counter updates per transition, so by
+ * default it is an adaptive lock: it spins with pause backoff for about
+ * as long as recent acquisitions needed, then parks on a futex. Build
+ * with -DBAKERY_LOCK=LOCK_PTHREAD, LOCK_TICKET or LOCK_MCS to use a
+ * pthread mutex or a FIFO ticket/MCS queue lock instead. `./src_ds
+ * --lock-bench [MAX_THREADS]` compares all four at 2..MAX_THREADS threads
+ * (default 128), for throughput and fairness. FIFO locks hand the lock to
+ * the next waiter even if it is descheduled, so they suffer once threads
+ * outnumber CPUs.
+ *
+ * Random draws use per-customer counter-based streams derived from
+ * BAKERY_SEED (default 1), so every run with the same seed makes the same
+ * choices.
+ *
+ * Seated customers do not sleep in their own thread. Their departure is
+ * scheduled on a hierarchical timing wheel (O(1) insert) and one timer
+ * thread, woken by a timerfd, fires all departures due in a tick as a
+ * batch under a single bakery_mutex acquisition.
+ *
+ * Model transitions do no I/O themselves. Each one appends a typed event
+ * (ARRIVE, QUEUE, ENTER, SEAT, LEAVE, REJECT, ...) to a shared ring, and every
+ * attached sink (text log, binary trace, stats, metrics) drains the ring on
+ * its own thread at its own pace. Emitting never waits for a sink: one
+ * that falls a whole ring behind skips ahead and reports how many events
+ * it dropped. Set BAKERY_TRACE=file to attach the binary trace sink.
+ *
+ * After leaving their table customers pay at one of BAKERY_CASHIERS
+ * cashiers (default 2). Each cashier has its own line, and a dispatcher
+ * routes customers by reading the line lengths with relaxed atomics only:
+ * BAKERY_CHECKOUT=jsq (join the shortest queue, default), p2c (shorter of
+ * two random lines), random, or shared (one line for all cashiers).
+ * `./src_ds --checkout-bench [customers] [cashiers]` runs the checkout
+ * stage alone under an open-loop load and compares the latency of every
+ * policy against the shared line and against random routing. At equal
+ * service rates a pooled line is the queueing-theory optimum; per-cashier
+ * lines pay off when one shared lock and wakeup channel becomes the
+ * limit, and JSQ/p2c recover most of the pooling benefit that random
+ * routing loses.
  */
 
 #include <stdio.h>
@@ -15,188 +78,2045 @@
 #include <semaphore.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <sched.h>
 
 /* Constants */
 #define MAX_TABLES 10            // Total number of tables in the bakery
 #define MAX_CUSTOMERS 100        // Maximum number of customers to simulate
 
+/* Metrics server */
+#define METRICS_SOCKET_PATH "/tmp/sweet_harmony.sock"  // Override with BAKERY_METRICS_SOCKET
+#define METRICS_MAX_CLIENTS 16   // Concurrent scrapers served by the event loop
+#define METRICS_BUF_SIZE 4096    // Size of one rendered snapshot
+#define LATENCY_BUCKETS 40       // log2(microseconds) histogram buckets
+
+/* Departure timing wheel */
+#define WHEEL_TICK_MS 10         // Resolution of one wheel tick
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)  // Slots per level
+#define WHEEL_LEVELS 4           // 64^4 ticks (~194 days at 10 ms) before clamping
+
+/* Event pipeline */
+#define EVENT_RING_SIZE 4096     // Events in flight (power of two)
+#define MAX_SINKS 8              // Sinks attached to one pipeline
+#define SINK_BATCH 256           // Events handed to a sink per call
+#define TRACE_MAGIC 0x3156455459524B42ULL  // "BKRYTEV1"
+
+/* Waiting lanes */
+#define HEAP_ARITY 4             // Children per node in the priority heap
+#define RANK_MAX_PRIORITY 255
+#define RANK_NO_DEADLINE ((1ULL << 56) - 1)
+#define VIP_SHARE 5              // One customer in VIP_SHARE books a table ahead
+#define RESERVATION_WINDOW_US 3000000L  // Booked customers expect a seat within 3 s
+
+/* Abandonment */
+#define PATIENCE_S 8             // Mean patience in line; override with BAKERY_PATIENCE (seconds)
+#define BALK_MIN 3               // Arrivals balk at a line of BALK_MIN..BALK_MAX of their color
+#define BALK_MAX 8
+
+/* Checkout */
+#define MAX_CASHIERS 16
+#define CHECKOUT_CASHIERS 2      // Default cashiers; override with BAKERY_CASHIERS
+#define CHECKOUT_MIN_MS 500      // Simulated payment takes 0.5-2 seconds
+#define CHECKOUT_MAX_MS 2000
+#define BENCH_SERVICE_US 2000    // Checkout bench: mean quick-basket service time
+#define BENCH_LOAD 0.85          // Checkout bench: offered load per cashier
+
+/* Bakery lock: build with -DBAKERY_LOCK=LOCK_PTHREAD (or _ADAPTIVE, _TICKET, _MCS) */
+#define LOCK_PTHREAD 0           // pthread_mutex_t
+#define LOCK_ADAPTIVE 1          // Spin with backoff, then park on a futex
+#define LOCK_TICKET 2            // FIFO ticket lock
+#define LOCK_MCS 3               // FIFO queue lock, each waiter spins on its own node
+#ifndef BAKERY_LOCK
+#define BAKERY_LOCK LOCK_ADAPTIVE
+#endif
+#define SPIN_MAX 200             // Adaptive lock: most lock polls before parking
+#define BACKOFF_MAX 64           // Longest pause burst between polls
+#define QUEUE_SPIN_YIELD 1000    // Ticket/MCS: polls before yielding the CPU
+#define LOCK_BENCH_MS 200        // Lock bench: length of one measurement
+
 /* Color enumeration */
 typedef enum {
     RED = 0,
     BLUE = 1
 } CustomerColor;
 
-/* Customer structure */
+/* Counter-based RNG stream: the n-th draw is a pure function of (key, n) */
 typedef struct {
+    uint64_t key;
+    uint64_t counter;
+} RngStream;
+
+/* Customer structure */
+typedef struct Customer {
     int id;                      // Unique customer ID
     CustomerColor color;         // RED or BLUE outfit
     int eating_time;             // Time spent at the table in seconds
     bool has_table;              // Whether customer is seated at a table
+    long arrival_us;             // Monotonic arrival time, for queue-wait latency
+    RngStream rng;               // This customer's private random stream
+    int table_id;                // Table held while seated
+    uint64_t depart_tick;        // Wheel tick at which the customer leaves
+    struct Customer* timer_next; // Link in a timing wheel slot
+    long checkout_cost_us;       // Time the cashier needs for this customer
+    long checkout_start_us;      // When the customer joined a checkout line
+    long checkout_latency_us;    // Line join to paid
+    struct Customer* checkout_next;  // Link in a checkout line
+    int priority;                // 0 = walk-in; higher is let in first within a color
+    long reserve_us;             // Reservation: expects a seat this long after arriving (0 = none)
+    sem_t admit;                 // Posted when this customer is let in from the line
+    long patience_us;            // Gives up after waiting this long in line
+    int balk_at;                 // Walks away on arrival if this many of their color are waiting
+    bool in_lane;                // Still waiting (false once admitted or given up)
+    int heap_index;              // Position in the lane heap, -1 for walk-ins
+    struct Customer* lane_prev;  // Links in the walk-in list
+    struct Customer* lane_next;
 } Customer;
 
-/* Bakery state structure */
-typedef struct {
-    int customers_inside;        // Total customers inside
-    int red_count;               // Customers wearing red
-    int blue_count;              // Customers wearing blue
-    int free_tables;             // Available tables
-    bool tables[MAX_TABLES];     // Table occupancy (true if occupied)
+/* Heap node for a prioritized customer; lower rank is served first */
+typedef struct {
+    uint64_t rank;               // (255 - priority) << 56 | seat-by deadline in us
+    long seq;                    // Arrival order within the lane, breaks ties
+    Customer* customer;
+} HeapNode;
+
+/* One color's line: an intrusive FIFO list for walk-ins plus a d-ary heap for VIPs and reservations */
+typedef struct {
+    Customer* head;              // Longest-waiting walk-in
+    Customer* tail;
+    int fifo_size;
+    HeapNode* heap;              // Pooled node array, grown by doubling
+    int heap_size;
+    int heap_capacity;
+    long next_seq;
+} WaitLane;
+
+/* Futex-based lock: spins adaptively, then sleeps in the kernel */
+typedef struct {
+    atomic_int state;            // 0 free, 1 held, 2 held with sleepers
+    atomic_int spin_estimate;    // Running average of polls that won the lock
+} AdaptiveLock;
+
+/* Ticket lock: waiters are served strictly in arrival order */
+typedef struct {
+    _Alignas(64) atomic_uint next_ticket;
+    _Alignas(64) atomic_uint now_serving;  // Own line, so arrivals do not disturb the holder
+} TicketLock;
+
+/* MCS queue node; a thread holds at most one MCS lock at a time */
+typedef struct McsNode {
+    _Alignas(64) struct McsNode* _Atomic next;
+    atomic_bool waiting;
+} McsNode;
+
+typedef struct {
+    McsNode* _Atomic tail;
+} McsLock;
+
+#if BAKERY_LOCK == LOCK_PTHREAD
+typedef pthread_mutex_t BakeryLock;
+#elif BAKERY_LOCK == LOCK_ADAPTIVE
+typedef AdaptiveLock BakeryLock;
+#elif BAKERY_LOCK == LOCK_TICKET
+typedef TicketLock BakeryLock;
+#elif BAKERY_LOCK == LOCK_MCS
+typedef McsLock BakeryLock;
+#else
+#error "BAKERY_LOCK must be LOCK_PTHREAD, LOCK_ADAPTIVE, LOCK_TICKET or LOCK_MCS"
+#endif
+
+/* Bakery state structure */
+typedef struct {
+    int customers_inside;        // Total customers inside
+    int red_count;               // Customers wearing red
+    int blue_count;              // Customers wearing blue
+    int free_tables;             // Available tables
+    bool tables[MAX_TABLES];     // Table occupancy (true if occupied)
+    
+    // Waiting customers, one lane per color (indexed by CustomerColor)
+    WaitLane lanes[2];
+    int reservations_seated;     // Booked customers seated from the line
+    int reservations_late;       // ...of which after their deadline
+    
+    // Synchronization objects
+    BakeryLock bakery_mutex;         // Protects the bakery state (see BAKERY_LOCK)
+    sem_t tables_sem;                // Controls table availability
+    pthread_cond_t balance_cond;     // Signals when color balance changes
+} BakeryState;
+
+/* Model transitions recorded by the engine */
+typedef enum {
+    EV_ARRIVE = 0,               // Customer reached the door
+    EV_QUEUE,                    // Customer had to wait in line
+    EV_ENTER,                    // Customer admitted by the balance rule
+    EV_SEAT,                     // Customer sat down at table_id
+    EV_LEAVE,                    // Customer left table_id
+    EV_REJECT,                   // Admitted from line but no table was left
+    EV_CHECKOUT,                 // Customer paid at cashier table_id
+    EV_BALK,                     // Customer saw the line and walked away
+    EV_RENEGE,                   // Customer ran out of patience and left the line
+    EV_TYPE_COUNT
+} EventType;
+
+/* One event, with a snapshot of the bakery taken under bakery_mutex */
+typedef struct {
+    long time_us;                // Monotonic timestamp
+    long wait_us;                // Arrival-to-seat wait (EV_SEAT), whole visit (EV_CHECKOUT), time in line (EV_RENEGE)
+    int customer_id;
+    int table_id;                // -1 unless seated or leaving; cashier for EV_CHECKOUT
+    uint16_t red_inside;
+    uint16_t blue_inside;
+    uint16_t red_waiting;
+    uint16_t blue_waiting;
+    uint8_t type;                // EventType
+    uint8_t color;               // CustomerColor
+    uint8_t from_queue;          // Entered after waiting in line
+    uint8_t customers_inside;
+} BakeryEvent;
+
+/* Ring slot; sequence is the event number last published into it, -1 while being rewritten */
+typedef struct {
+    atomic_long sequence;
+    BakeryEvent event;
+} EventSlot;
+
+/* A consumer of the event stream, run on its own thread */
+typedef struct EventSink {
+    const char* name;
+    void (*consume)(struct EventSink* sink, const BakeryEvent* events, int count);
+    void (*finish)(struct EventSink* sink);   // Called by pipeline_close() once every sink has drained; may be NULL
+    void* state;
+    atomic_long cursor;          // Next event number this sink will read
+    atomic_long dropped;         // Events overwritten before this sink read them
+    pthread_t thread;
+} EventSink;
+
+/*
+ * Multi-producer ring with one independent cursor per sink. A producer
+ * claims an event number with one fetch-add and publishes by storing the
+ * number into the slot; it never waits for sinks, because it runs under
+ * bakery_mutex and one stalled sink must not freeze the bakery. A sink
+ * that falls a full lap behind finds its slots reused, skips ahead and
+ * counts what it missed. Adding sinks adds no work to the producer.
+ */
+typedef struct {
+    EventSlot slots[EVENT_RING_SIZE];
+    atomic_long next_seq;        // Next event number to claim
+    EventSink* sinks[MAX_SINKS];
+    int sink_count;
+    atomic_bool closing;
+} EventPipeline;
+
+/*
+ * Lock-free metrics mirror of the bakery state.
+ * Writers update these with relaxed atomics (usually while already holding
+ * bakery_mutex); the metrics thread only ever reads them, so scraping never
+ * takes the bakery lock or perturbs the simulation.
+ */
+typedef struct {
+    atomic_long arrivals;        // Customers that arrived
+    atomic_long queued;          // Customers that had to wait in line
+    atomic_long served;          // Customers that finished and left
+    atomic_long balked;          // Customers that walked away on arrival
+    atomic_long reneged;         // Customers that left the line after queueing
+    atomic_int red_inside;       // Gauges, republished on every transition
+    atomic_int blue_inside;
+    atomic_int tables_used;
+    atomic_int red_waiting;
+    atomic_int blue_waiting;
+    atomic_long wait_sum_us;     // Sum of arrival-to-seat waits
+    atomic_long wait_hist[LATENCY_BUCKETS];  // Bucket i counts waits < 2^i us
+} Metrics;
+
+/*
+ * Hierarchical timing wheel (Varghese & Lauck). Level 0 slots are one tick
+ * wide; each higher level slot covers a whole lap of the level below and is
+ * cascaded down when the lower level wraps. Insert is O(1) and a tick only
+ * touches the customers that are due, however many are seated.
+ */
+typedef struct {
+    Customer* slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    uint64_t now;                // Ticks processed so far
+    int pending;                 // Departures scheduled but not yet fired
+    pthread_mutex_t lock;        // Protects the wheel (never held with bakery_mutex)
+    pthread_cond_t drained;      // Signalled when pending drops to zero
+    int timer_fd;
+    atomic_bool running;
+} TimerWheel;
+
+/* How the dispatcher picks a checkout line */
+typedef enum {
+    CHECKOUT_SHARED = 0,         // One line served by every cashier
+    CHECKOUT_RANDOM,             // Uniformly random line
+    CHECKOUT_JSQ,                // Shortest line
+    CHECKOUT_P2C,                // Shorter of two random lines
+    CHECKOUT_POLICY_COUNT
+} CheckoutPolicy;
+
+/* One cashier's line; length counts customers waiting plus the one being served */
+typedef struct {
+    _Alignas(64) atomic_int length;  // Written by dispatch/cashier, read relaxed by the dispatcher
+    pthread_mutex_t lock;        // Protects head/tail; shared only by dispatcher and cashier(s)
+    pthread_cond_t ready;
+    Customer* head;
+    Customer* tail;
+} CheckoutLine;
+
+/* Checkout stage: K cashiers, each draining its own line (or all one line) */
+typedef struct {
+    CheckoutLine lines[MAX_CASHIERS];
+    pthread_t cashiers[MAX_CASHIERS];
+    int cashier_count;
+    CheckoutPolicy policy;
+    bool closing;                // Set under every line lock by stop_checkout()
+    void (*paid)(Customer* customer, int cashier);  // Called after payment; may be NULL
+} Checkout;
+
+/* Global state */
+BakeryState bakery;
+TimerWheel wheel;
+EventPipeline pipeline;
+Checkout checkout;
+Metrics metrics;
+atomic_bool metrics_running;
+long metrics_start_us;
+
+/* Function prototypes */
+void adaptive_lock_init(AdaptiveLock* lock);
+void adaptive_lock(AdaptiveLock* lock);
+void adaptive_unlock(AdaptiveLock* lock);
+void ticket_lock_init(TicketLock* lock);
+void ticket_lock(TicketLock* lock);
+void ticket_unlock(TicketLock* lock);
+void mcs_lock_init(McsLock* lock);
+void mcs_lock(McsLock* lock);
+void mcs_unlock(McsLock* lock);
+void bakery_lock();
+void bakery_unlock();
+int lock_bench(int max_threads);
+bool init_bakery(int total_tables);
+void cleanup_bakery();
+int find_free_table();
+void* customer_behavior(void* arg);
+bool lane_init(WaitLane* lane, int capacity);
+void lane_destroy(WaitLane* lane);
+int lane_size(const WaitLane* lane);
+bool lane_push(WaitLane* lane, Customer* customer);
+Customer* lane_peek(const WaitLane* lane);
+Customer* lane_pop(WaitLane* lane);
+void lane_remove(WaitLane* lane, Customer* customer);
+bool enqueue_customer(Customer* customer);
+Customer* dequeue_customer(CustomerColor color);
+int queue_bench(int waiting);
+bool can_enter(CustomerColor color);
+void try_balance_entry();
+uint64_t rng_mix(uint64_t z);
+RngStream rng_stream(uint64_t seed, uint64_t stream_id);
+uint64_t rng_next(RngStream* stream);
+long now_us();
+void publish_gauges(const BakeryEvent* event);
+void record_wait(long wait_us);
+void emit_event(EventType type, Customer* customer, int table_id, bool from_queue);
+void pipeline_add_sink(EventSink* sink);
+void pipeline_start();
+void pipeline_close();
+int start_metrics_server(const char* path, pthread_t* thread);
+void stop_metrics_server(pthread_t thread, const char* path);
+int start_timer_wheel(pthread_t* thread);
+void stop_timer_wheel(pthread_t thread);
+void schedule_departure(Customer* customer);
+void customer_leave(Customer* customer);
+const char* checkout_policy_name(CheckoutPolicy policy);
+int start_checkout(int cashiers, CheckoutPolicy policy, void (*paid)(Customer*, int));
+void checkout_dispatch(Customer* customer);
+void stop_checkout();
+int checkout_bench(long customers, int cashiers);
+
+/* Let a spinning hyperthread sibling (or the memory system) make progress */
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* Spinning only helps if the holder can run meanwhile */
+static bool spinning_pays() {
+    static int cpus = 0;
+    if (cpus == 0) {
+        cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    return cpus > 1;
+}
+
+static void futex_wait(atomic_int* addr, int expected) {
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static void futex_wake(atomic_int* addr, int count) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+void adaptive_lock_init(AdaptiveLock* lock) {
+    atomic_init(&lock->state, 0);
+    atomic_init(&lock->spin_estimate, SPIN_MAX / 8);
+}
+
+/*
+ * Uncontended: one CAS. Contended: poll with exponential pause backoff for
+ * up to twice the recent successful spin count (glibc's adaptive-mutex
+ * rule), so a lock whose holders leave quickly is won without a syscall
+ * and one that is held long stops wasting cycles. Then park on the futex
+ * (Drepper's three-state mutex: state 2 tells the holder to wake someone).
+ */
+void adaptive_lock(AdaptiveLock* lock) {
+    int expected = 0;
+    if (atomic_compare_exchange_strong_explicit(&lock->state, &expected, 1,
+                                                memory_order_acquire, memory_order_relaxed)) {
+        return;
+    }
+    
+    if (spinning_pays()) {
+        int estimate = atomic_load_explicit(&lock->spin_estimate, memory_order_relaxed);
+        int limit = estimate * 2 + 10 < SPIN_MAX ? estimate * 2 + 10 : SPIN_MAX;
+        int backoff = 1;
+        for (int spins = 1; spins <= limit; spins++) {
+            for (int i = 0; i < backoff; i++) {
+                cpu_relax();
+            }
+            backoff = backoff * 2 < BACKOFF_MAX ? backoff * 2 : BACKOFF_MAX;
+            expected = 0;
+            if (atomic_load_explicit(&lock->state, memory_order_relaxed) == 0 &&
+                atomic_compare_exchange_weak_explicit(&lock->state, &expected, 1,
+                                                      memory_order_acquire, memory_order_relaxed)) {
+                atomic_store_explicit(&lock->spin_estimate, estimate + (spins - estimate) / 8,
+                                      memory_order_relaxed);
+                return;
+            }
+        }
+        atomic_store_explicit(&lock->spin_estimate, estimate + (limit - estimate) / 8,
+                              memory_order_relaxed);
+    }
+    
+    // Park: mark the lock contended, and sleep until it is handed back free
+    while (atomic_exchange_explicit(&lock->state, 2, memory_order_acquire) != 0) {
+        futex_wait(&lock->state, 2);
+    }
+}
+
+void adaptive_unlock(AdaptiveLock* lock) {
+    if (atomic_exchange_explicit(&lock->state, 0, memory_order_release) == 2) {
+        futex_wake(&lock->state, 1);
+    }
+}
+
+void ticket_lock_init(TicketLock* lock) {
+    atomic_init(&lock->next_ticket, 0);
+    atomic_init(&lock->now_serving, 0);
+}
+
+/* Take a ticket and wait for it; backoff grows with our distance from the front */
+void ticket_lock(TicketLock* lock) {
+    unsigned ticket = atomic_fetch_add_explicit(&lock->next_ticket, 1, memory_order_relaxed);
+    for (int polls = 0;; polls++) {
+        unsigned serving = atomic_load_explicit(&lock->now_serving, memory_order_acquire);
+        if (serving == ticket) {
+            return;
+        }
+        if (polls >= QUEUE_SPIN_YIELD || !spinning_pays()) {
+            sched_yield();  // A preempted holder or predecessor needs this CPU
+            continue;
+        }
+        for (unsigned i = 0; i < ticket - serving && i < BACKOFF_MAX; i++) {
+            cpu_relax();
+        }
+    }
+}
+
+void ticket_unlock(TicketLock* lock) {
+    unsigned next = atomic_load_explicit(&lock->now_serving, memory_order_relaxed) + 1;
+    atomic_store_explicit(&lock->now_serving, next, memory_order_release);
+}
+
+/* This thread's queue node for mcs_lock() */
+static _Thread_local McsNode mcs_self;
+
+void mcs_lock_init(McsLock* lock) {
+    atomic_init(&lock->tail, NULL);
+}
+
+/* Join the queue; each waiter spins on its own node, so a release touches one cache line */
+void mcs_lock(McsLock* lock) {
+    McsNode* self = &mcs_self;
+    atomic_store_explicit(&self->next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&self->waiting, true, memory_order_relaxed);
+    McsNode* prev = atomic_exchange_explicit(&lock->tail, self, memory_order_acq_rel);
+    if (prev == NULL) {
+        return;
+    }
+    atomic_store_explicit(&prev->next, self, memory_order_release);
+    for (int polls = 0; atomic_load_explicit(&self->waiting, memory_order_acquire); polls++) {
+        if (polls >= QUEUE_SPIN_YIELD || !spinning_pays()) {
+            sched_yield();
+        } else {
+            cpu_relax();
+        }
+    }
+}
+
+void mcs_unlock(McsLock* lock) {
+    McsNode* self = &mcs_self;
+    McsNode* next = atomic_load_explicit(&self->next, memory_order_acquire);
+    if (next == NULL) {
+        McsNode* expected = self;
+        if (atomic_compare_exchange_strong_explicit(&lock->tail, &expected, NULL,
+                                                    memory_order_release, memory_order_relaxed)) {
+            return;
+        }
+        // A successor swapped itself in but has not linked to us yet
+        while ((next = atomic_load_explicit(&self->next, memory_order_acquire)) == NULL) {
+            cpu_relax();
+        }
+    }
+    atomic_store_explicit(&next->waiting, false, memory_order_release);
+}
+
+/* Acquire the lock that protects the bakery state, as chosen by BAKERY_LOCK */
+void bakery_lock() {
+#if BAKERY_LOCK == LOCK_PTHREAD
+    pthread_mutex_lock(&bakery.bakery_mutex);
+#elif BAKERY_LOCK == LOCK_ADAPTIVE
+    adaptive_lock(&bakery.bakery_mutex);
+#elif BAKERY_LOCK == LOCK_TICKET
+    ticket_lock(&bakery.bakery_mutex);
+#else
+    mcs_lock(&bakery.bakery_mutex);
+#endif
+}
+
+void bakery_unlock() {
+#if BAKERY_LOCK == LOCK_PTHREAD
+    pthread_mutex_unlock(&bakery.bakery_mutex);
+#elif BAKERY_LOCK == LOCK_ADAPTIVE
+    adaptive_unlock(&bakery.bakery_mutex);
+#elif BAKERY_LOCK == LOCK_TICKET
+    ticket_unlock(&bakery.bakery_mutex);
+#else
+    mcs_unlock(&bakery.bakery_mutex);
+#endif
+}
+
+/* Initialize bakery state and synchronization objects; false if out of memory */
+bool init_bakery(int total_tables) {
+    bakery.customers_inside = 0;
+    bakery.red_count = 0;
+    bakery.blue_count = 0;
+    bakery.free_tables = total_tables;
+    
+    // Initialize table states
+    for (int i = 0; i < MAX_TABLES; i++) {
+        bakery.tables[i] = false;  // All tables start unoccupied
+    }
+    
+    // Initialize queues
+    if (!lane_init(&bakery.lanes[RED], MAX_CUSTOMERS) ||
+        !lane_init(&bakery.lanes[BLUE], MAX_CUSTOMERS)) {
+        return false;
+    }
+    bakery.reservations_seated = 0;
+    bakery.reservations_late = 0;
+    
+    // Initialize synchronization objects
+#if BAKERY_LOCK == LOCK_PTHREAD
+    pthread_mutex_init(&bakery.bakery_mutex, NULL);
+#elif BAKERY_LOCK == LOCK_ADAPTIVE
+    adaptive_lock_init(&bakery.bakery_mutex);
+#elif BAKERY_LOCK == LOCK_TICKET
+    ticket_lock_init(&bakery.bakery_mutex);
+#else
+    mcs_lock_init(&bakery.bakery_mutex);
+#endif
+    sem_init(&bakery.tables_sem, 0, total_tables);  // Start with all tables free
+    pthread_cond_init(&bakery.balance_cond, NULL);
+    return true;
+}
+
+/* Clean up resources */
+void cleanup_bakery() {
+#if BAKERY_LOCK == LOCK_PTHREAD
+    pthread_mutex_destroy(&bakery.bakery_mutex);
+#endif
+    lane_destroy(&bakery.lanes[RED]);
+    lane_destroy(&bakery.lanes[BLUE]);
+    sem_destroy(&bakery.tables_sem);
+    pthread_cond_destroy(&bakery.balance_cond);
+}
+
+/* Find an available table; returns table ID or -1 if none available */
+int find_free_table() {
+    for (int i = 0; i < MAX_TABLES; i++) {
+        if (!bakery.tables[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Ordering key of a prioritized customer: higher priority, then earlier deadline */
+static uint64_t lane_rank(const Customer* customer) {
+    uint64_t deadline = customer->reserve_us > 0 ? (uint64_t)(customer->arrival_us + customer->reserve_us)
+                                                 : RANK_NO_DEADLINE;
+    if (deadline > RANK_NO_DEADLINE) {
+        deadline = RANK_NO_DEADLINE;
+    }
+    return ((uint64_t)(RANK_MAX_PRIORITY - customer->priority) << 56) | deadline;
+}
+
+/* Heap order: rank, then arrival order within the lane */
+static bool node_before(const HeapNode* a, const HeapNode* b) {
+    return a->rank < b->rank || (a->rank == b->rank && a->seq < b->seq);
+}
+
+/* Set up an empty lane; the heap arena starts with room for capacity nodes. False if out of memory */
+bool lane_init(WaitLane* lane, int capacity) {
+    lane->head = NULL;
+    lane->tail = NULL;
+    lane->fifo_size = 0;
+    lane->heap = malloc(sizeof(HeapNode) * capacity);
+    lane->heap_size = 0;
+    lane->heap_capacity = lane->heap != NULL ? capacity : 0;
+    lane->next_seq = 0;
+    return lane->heap != NULL || capacity == 0;
+}
+
+void lane_destroy(WaitLane* lane) {
+    free(lane->heap);
+}
+
+/* Customers waiting in a lane */
+int lane_size(const WaitLane* lane) {
+    return lane->fifo_size + lane->heap_size;
+}
+
+/* Place node at heap index i, keeping its customer's back-index current */
+static void heap_set(WaitLane* lane, int i, HeapNode node) {
+    lane->heap[i] = node;
+    node.customer->heap_index = i;
+}
+
+/* Move node up from hole i until its parent comes before it */
+static void heap_sift_up(WaitLane* lane, int i, HeapNode node) {
+    while (i > 0) {
+        int parent = (i - 1) / HEAP_ARITY;
+        if (!node_before(&node, &lane->heap[parent])) {
+            break;
+        }
+        heap_set(lane, i, lane->heap[parent]);
+        i = parent;
+    }
+    heap_set(lane, i, node);
+}
+
+/* Move node down from hole i until no child comes before it */
+static void heap_sift_down(WaitLane* lane, int i, HeapNode node) {
+    int n = lane->heap_size;
+    for (;;) {
+        int first = i * HEAP_ARITY + 1;
+        if (first >= n) {
+            break;
+        }
+        int best = first;
+        int end = first + HEAP_ARITY < n ? first + HEAP_ARITY : n;
+        for (int c = first + 1; c < end; c++) {
+            if (node_before(&lane->heap[c], &lane->heap[best])) {
+                best = c;
+            }
+        }
+        if (!node_before(&lane->heap[best], &node)) {
+            break;
+        }
+        heap_set(lane, i, lane->heap[best]);
+        i = best;
+    }
+    heap_set(lane, i, node);
+}
+
+/*
+ * Add a customer: walk-ins are linked at the tail in O(1), priority customers
+ * go to the heap. False if the heap arena could not grow; the lane is unchanged.
+ */
+bool lane_push(WaitLane* lane, Customer* customer) {
+    if (customer->priority == 0 && customer->reserve_us == 0) {
+        customer->in_lane = true;
+        customer->heap_index = -1;
+        customer->lane_next = NULL;
+        customer->lane_prev = lane->tail;
+        if (lane->tail != NULL) {
+            lane->tail->lane_next = customer;
+        } else {
+            lane->head = customer;
+        }
+        lane->tail = customer;
+        lane->fifo_size++;
+        return true;
+    }
+    
+    // Node arena doubles as needed and is never shrunk, so steady state does no allocation
+    if (lane->heap_size == lane->heap_capacity) {
+        int capacity = lane->heap_capacity > 0 ? lane->heap_capacity * 2 : MAX_CUSTOMERS;
+        HeapNode* heap = realloc(lane->heap, sizeof(HeapNode) * capacity);
+        if (heap == NULL) {
+            return false;
+        }
+        lane->heap = heap;
+        lane->heap_capacity = capacity;
+    }
+    customer->in_lane = true;
+    HeapNode node = { lane_rank(customer), lane->next_seq++, customer };
+    heap_sift_up(lane, lane->heap_size++, node);
+    return true;
+}
+
+/* Next customer to admit without removing them: prioritized customers before walk-ins */
+Customer* lane_peek(const WaitLane* lane) {
+    if (lane->heap_size > 0) {
+        return lane->heap[0].customer;
+    }
+    return lane->head;
+}
+
+/*
+ * Take a customer out of the lane wherever they stand: O(1) unlink for a
+ * walk-in, O(log n) for a heap entry (the last node fills the hole and is
+ * sifted whichever way it belongs). Used both for admission and for
+ * customers who give up waiting.
+ */
+void lane_remove(WaitLane* lane, Customer* customer) {
+    customer->in_lane = false;
+    if (customer->heap_index < 0) {
+        if (customer->lane_prev != NULL) {
+            customer->lane_prev->lane_next = customer->lane_next;
+        } else {
+            lane->head = customer->lane_next;
+        }
+        if (customer->lane_next != NULL) {
+            customer->lane_next->lane_prev = customer->lane_prev;
+        } else {
+            lane->tail = customer->lane_prev;
+        }
+        customer->lane_prev = customer->lane_next = NULL;
+        lane->fifo_size--;
+        return;
+    }
+    
+    int i = customer->heap_index;
+    customer->heap_index = -1;
+    HeapNode last = lane->heap[--lane->heap_size];
+    if (i == lane->heap_size) {
+        return;
+    }
+    if (i > 0 && node_before(&last, &lane->heap[(i - 1) / HEAP_ARITY])) {
+        heap_sift_up(lane, i, last);
+    } else {
+        heap_sift_down(lane, i, last);
+    }
+}
+
+/* Remove and return the next customer to admit, or NULL if the lane is empty */
+Customer* lane_pop(WaitLane* lane) {
+    Customer* customer = lane_peek(lane);
+    if (customer != NULL) {
+        lane_remove(lane, customer);
+    }
+    return customer;
+}
+
+/* Enqueue a customer in their color's queue; false if out of memory */
+bool enqueue_customer(Customer* customer) {
+    return lane_push(&bakery.lanes[customer->color], customer);
+}
+
+/* Dequeue the next customer to admit from their color's queue */
+Customer* dequeue_customer(CustomerColor color) {
+    return lane_pop(&bakery.lanes[color]);
+}
+
+/* Check if a customer of given color can enter based on balance rule */
+bool can_enter(CustomerColor color) {
+    if (bakery.customers_inside == 0) {
+        // First customer can always enter
+        return true;
+    }
+    
+    if (color == RED) {
+        // Red customer can enter if doing so maintains or improves balance
+        return bakery.red_count < bakery.blue_count;
+    } else {
+        // Blue customer can enter if doing so maintains or improves balance
+        return bakery.blue_count < bakery.red_count;
+    }
+}
+
+/* Whether a's head of line is more urgent than b's (VIPs, then deadlines, then arrival) */
+static bool more_urgent(const Customer* a, const Customer* b) {
+    uint64_t rank_a = a->priority > 0 || a->reserve_us > 0 ? lane_rank(a) : UINT64_MAX;
+    uint64_t rank_b = b->priority > 0 || b->reserve_us > 0 ? lane_rank(b) : UINT64_MAX;
+    if (rank_a != rank_b) {
+        return rank_a < rank_b;
+    }
+    return a->arrival_us <= b->arrival_us;
+}
+
+/* Try to maintain balance by letting the next waiting customer in */
+void try_balance_entry() {
+    if (bakery.free_tables == 0) {
+        return;
+    }
+    Customer* red = lane_peek(&bakery.lanes[RED]);
+    Customer* blue = lane_peek(&bakery.lanes[BLUE]);
+    CustomerColor color;
+    
+    if (bakery.red_count < bakery.blue_count && red != NULL) {
+        color = RED;             // Red is behind
+    } else if (bakery.blue_count < bakery.red_count && blue != NULL) {
+        color = BLUE;            // Blue is behind
+    } else if (bakery.red_count == bakery.blue_count && (red != NULL || blue != NULL)) {
+        // Balanced: either color may go, so the more urgent head of line does
+        color = blue == NULL || (red != NULL && more_urgent(red, blue)) ? RED : BLUE;
+    } else {
+        return;                  // Nobody waiting, or no one who would improve balance
+    }
+    
+    // Hand the wake-up to exactly the customer taken off the line
+    Customer* customer = dequeue_customer(color);
+    sem_post(&customer->admit);
+}
+
+/* SplitMix64 finalizer: a strong 64-bit bijective mix */
+uint64_t rng_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Derive an independent stream from a seed and a stream number */
+RngStream rng_stream(uint64_t seed, uint64_t stream_id) {
+    RngStream stream = { rng_mix(seed ^ rng_mix(stream_id + 0x9E3779B97F4A7C15ULL)), 0 };
+    return stream;
+}
+
+/* Next 64-bit draw; streams share no state, so there is no hidden lock */
+uint64_t rng_next(RngStream* stream) {
+    return rng_mix(stream->key + ++stream->counter * 0x9E3779B97F4A7C15ULL);
+}
+
+/* Monotonic clock in microseconds */
+long now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+/* Mirror the gauges carried by an event into the metrics block */
+void publish_gauges(const BakeryEvent* event) {
+    atomic_store_explicit(&metrics.red_inside, event->red_inside, memory_order_relaxed);
+    atomic_store_explicit(&metrics.blue_inside, event->blue_inside, memory_order_relaxed);
+    atomic_store_explicit(&metrics.tables_used, event->customers_inside, memory_order_relaxed);
+    atomic_store_explicit(&metrics.red_waiting, event->red_waiting, memory_order_relaxed);
+    atomic_store_explicit(&metrics.blue_waiting, event->blue_waiting, memory_order_relaxed);
+}
+
+/* Add one arrival-to-seat wait to the latency histogram */
+void record_wait(long wait_us) {
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (1L << bucket) <= wait_us) {
+        bucket++;
+    }
+    atomic_fetch_add_explicit(&metrics.wait_hist[bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&metrics.wait_sum_us, wait_us, memory_order_relaxed);
+}
+
+/* Upper bound (us) of the histogram bucket holding the given quantile */
+static long wait_percentile(const long* hist, long total, double q) {
+    if (total == 0) {
+        return 0;
+    }
+    long rank = (long)(q * total);
+    long seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen > rank) {
+            return 1L << i;
+        }
+    }
+    return 1L << (LATENCY_BUCKETS - 1);
+}
+
+/* Render a point-in-time snapshot as Prometheus text or JSON; returns length */
+static int render_metrics(char* buf, size_t size, bool json) {
+    long hist[LATENCY_BUCKETS];
+    long admitted = 0;  // Every admission lands in exactly one bucket
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        hist[i] = atomic_load_explicit(&metrics.wait_hist[i], memory_order_relaxed);
+        admitted += hist[i];
+    }
+    long arrivals = atomic_load_explicit(&metrics.arrivals, memory_order_relaxed);
+    long queued = atomic_load_explicit(&metrics.queued, memory_order_relaxed);
+    long served = atomic_load_explicit(&metrics.served, memory_order_relaxed);
+    long balked = atomic_load_explicit(&metrics.balked, memory_order_relaxed);
+    long reneged = atomic_load_explicit(&metrics.reneged, memory_order_relaxed);
+    long wait_sum = atomic_load_explicit(&metrics.wait_sum_us, memory_order_relaxed);
+    int red = atomic_load_explicit(&metrics.red_inside, memory_order_relaxed);
+    int blue = atomic_load_explicit(&metrics.blue_inside, memory_order_relaxed);
+    int tables = atomic_load_explicit(&metrics.tables_used, memory_order_relaxed);
+    int red_wait = atomic_load_explicit(&metrics.red_waiting, memory_order_relaxed);
+    int blue_wait = atomic_load_explicit(&metrics.blue_waiting, memory_order_relaxed);
+    double uptime = (now_us() - metrics_start_us) / 1e6;
+    double throughput = uptime > 0 ? served / uptime : 0.0;
+    long p50 = wait_percentile(hist, admitted, 0.50);
+    long p90 = wait_percentile(hist, admitted, 0.90);
+    long p99 = wait_percentile(hist, admitted, 0.99);
+
+    if (json) {
+        return snprintf(buf, size,
+            "{\"uptime_seconds\":%.3f,\"arrivals\":%ld,\"queued\":%ld,\"admitted\":%ld,"
+            "\"served\":%ld,\"balked\":%ld,\"reneged\":%ld,\"throughput_per_second\":%.3f,"
+            "\"inside\":{\"red\":%d,\"blue\":%d},\"tables_used\":%d,"
+            "\"waiting\":{\"red\":%d,\"blue\":%d},"
+            "\"queue_wait_us\":{\"sum\":%ld,\"p50\":%ld,\"p90\":%ld,\"p99\":%ld}}\n",
+            uptime, arrivals, queued, admitted, served, balked, reneged, throughput,
+            red, blue, tables, red_wait, blue_wait, wait_sum, p50, p90, p99);
+    }
+
+    return snprintf(buf, size,
+        "# TYPE bakery_uptime_seconds gauge\n"
+        "bakery_uptime_seconds %.3f\n"
+        "# TYPE bakery_arrivals_total counter\n"
+        "bakery_arrivals_total %ld\n"
+        "# TYPE bakery_queued_total counter\n"
+        "bakery_queued_total %ld\n"
+        "# TYPE bakery_admitted_total counter\n"
+        "bakery_admitted_total %ld\n"
+        "# TYPE bakery_served_total counter\n"
+        "bakery_served_total %ld\n"
+        "# TYPE bakery_abandoned_total counter\n"
+        "bakery_abandoned_total{reason=\"balk\"} %ld\n"
+        "bakery_abandoned_total{reason=\"renege\"} %ld\n"
+        "# TYPE bakery_throughput_per_second gauge\n"
+        "bakery_throughput_per_second %.3f\n"
+        "# TYPE bakery_inside gauge\n"
+        "bakery_inside{color=\"red\"} %d\n"
+        "bakery_inside{color=\"blue\"} %d\n"
+        "# TYPE bakery_tables_used gauge\n"
+        "bakery_tables_used %d\n"
+        "# TYPE bakery_queue_depth gauge\n"
+        "bakery_queue_depth{color=\"red\"} %d\n"
+        "bakery_queue_depth{color=\"blue\"} %d\n"
+        "# TYPE bakery_queue_wait_us summary\n"
+        "bakery_queue_wait_us{quantile=\"0.5\"} %ld\n"
+        "bakery_queue_wait_us{quantile=\"0.9\"} %ld\n"
+        "bakery_queue_wait_us{quantile=\"0.99\"} %ld\n"
+        "bakery_queue_wait_us_sum %ld\n"
+        "bakery_queue_wait_us_count %ld\n",
+        uptime, arrivals, queued, admitted, served, balked, reneged, throughput,
+        red, blue, tables, red_wait, blue_wait, p50, p90, p99, wait_sum, admitted);
+}
+
+/* One scraper connection: the request is read, then the snapshot is written */
+typedef struct {
+    int fd;
+    bool responding;
+    int length;
+    int sent;
+    char buf[METRICS_BUF_SIZE];
+} MetricsClient;
+
+/* Non-blocking poll() event loop serving metrics snapshots */
+static void* metrics_thread(void* arg) {
+    int listen_fd = (int)(long)arg;
+    static MetricsClient clients[METRICS_MAX_CLIENTS];
+    struct pollfd fds[METRICS_MAX_CLIENTS + 1];
+
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+
+    while (atomic_load(&metrics_running)) {
+        int slot_of[METRICS_MAX_CLIENTS + 1];
+        int nfds = 0;
+
+        fds[nfds].fd = listen_fd;
+        fds[nfds].events = POLLIN;
+        nfds++;
+        for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+            if (clients[i].fd >= 0) {
+                fds[nfds].fd = clients[i].fd;
+                fds[nfds].events = clients[i].responding ? POLLOUT : POLLIN;
+                slot_of[nfds] = i;
+                nfds++;
+            }
+        }
+
+        // Short timeout so shutdown is noticed promptly
+        if (poll(fds, nfds, 200) <= 0) {
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+                int slot = -1;
+                for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+                    if (clients[i].fd < 0) {
+                        slot = i;
+                        break;
+                    }
+                }
+                if (slot == -1) {
+                    close(fd);  // Too many scrapers; drop this one
+                    continue;
+                }
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                clients[slot].fd = fd;
+                clients[slot].responding = false;
+                clients[slot].length = 0;
+                clients[slot].sent = 0;
+            }
+        }
+
+        for (int k = 1; k < nfds; k++) {
+            MetricsClient* client = &clients[slot_of[k]];
+            bool done = false;
+
+            if (!client->responding && (fds[k].revents & (POLLIN | POLLHUP))) {
+                // A request containing "json" selects JSON; EOF or anything else means Prometheus
+                char request[64];
+                ssize_t n = read(client->fd, request, sizeof(request) - 1);
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    continue;
+                }
+                request[n > 0 ? n : 0] = '\0';
+                client->length = render_metrics(client->buf, sizeof(client->buf),
+                                                strstr(request, "json") != NULL);
+                if (client->length >= (int)sizeof(client->buf)) {
+                    client->length = sizeof(client->buf) - 1;
+                }
+                client->responding = true;
+            }
+
+            if (client->responding) {
+                ssize_t n = write(client->fd, client->buf + client->sent,
+                                  client->length - client->sent);
+                if (n > 0) {
+                    client->sent += n;
+                }
+                if (client->sent >= client->length ||
+                    (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    done = true;
+                }
+            } else if (fds[k].revents & (POLLERR | POLLNVAL)) {
+                done = true;
+            }
+
+            if (done) {
+                close(client->fd);
+                client->fd = -1;
+            }
+        }
+    }
+
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) {
+            close(clients[i].fd);
+        }
+    }
+    close(listen_fd);
+    return NULL;
+}
+
+/* Bind the metrics socket and start its thread; returns 0 on success */
+int start_metrics_server(const char* path, pthread_t* thread) {
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        perror("Error creating metrics socket");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Metrics socket path %s is too long.\n", path);
+        close(fd);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // Remove a stale socket from a previous run, but never anything else
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "%s exists and is not a socket; not replacing it.\n", path);
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        perror("Error binding metrics socket");
+        close(fd);
+        return -1;
+    }
+
+    metrics_start_us = now_us();
+    atomic_store(&metrics_running, true);
+    if (pthread_create(thread, NULL, metrics_thread, (void*)(long)fd) != 0) {
+        perror("Error creating metrics thread");
+        atomic_store(&metrics_running, false);
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    return 0;
+}
+
+/* Stop the metrics thread and remove its socket */
+void stop_metrics_server(pthread_t thread, const char* path) {
+    atomic_store(&metrics_running, false);
+    pthread_join(thread, NULL);
+    unlink(path);
+}
+
+/* Record a model transition; caller holds bakery_mutex so the snapshot is consistent */
+void emit_event(EventType type, Customer* customer, int table_id, bool from_queue) {
+    long seq = atomic_fetch_add_explicit(&pipeline.next_seq, 1, memory_order_relaxed);
+    
+    // No back-pressure: mark the slot as being rewritten so a lapped sink cannot take a torn copy
+    EventSlot* slot = &pipeline.slots[seq & (EVENT_RING_SIZE - 1)];
+    atomic_store_explicit(&slot->sequence, -1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    BakeryEvent* event = &slot->event;
+    event->time_us = now_us();
+    event->wait_us = type == EV_SEAT || type == EV_CHECKOUT || type == EV_RENEGE
+                   ? event->time_us - customer->arrival_us : 0;
+    event->customer_id = customer->id;
+    event->table_id = table_id;
+    event->red_inside = bakery.red_count;
+    event->blue_inside = bakery.blue_count;
+    event->red_waiting = lane_size(&bakery.lanes[RED]);
+    event->blue_waiting = lane_size(&bakery.lanes[BLUE]);
+    event->type = type;
+    event->color = customer->color;
+    event->from_queue = from_queue;
+    event->customers_inside = bakery.customers_inside;
+    atomic_store_explicit(&slot->sequence, seq, memory_order_release);
+}
+
+/* Sink thread: hand every published event to the sink in order, in batches */
+static void* sink_thread(void* arg) {
+    EventSink* sink = (EventSink*)arg;
+    BakeryEvent batch[SINK_BATCH];
+    long cursor = atomic_load(&sink->cursor);
+    
+    for (;;) {
+        int count = 0;
+        while (count < SINK_BATCH) {
+            EventSlot* slot = &pipeline.slots[(cursor + count) & (EVENT_RING_SIZE - 1)];
+            if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != cursor + count) {
+                break;
+            }
+            batch[count] = slot->event;
+            
+            // Seqlock check: a producer a lap ahead may have rewritten the slot while we copied
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) != cursor + count) {
+                break;
+            }
+            count++;
+        }
+        
+        // Lapped: the next event we want has been overwritten; resume half a ring behind the head
+        long head = atomic_load_explicit(&pipeline.next_seq, memory_order_relaxed);
+        bool lapped = head - (cursor + count) > EVENT_RING_SIZE;
+        
+        if (count > 0) {
+            cursor += count;
+            atomic_store_explicit(&sink->cursor, cursor, memory_order_release);
+            sink->consume(sink, batch, count);
+        }
+        if (lapped) {
+            long resume = head - EVENT_RING_SIZE / 2;
+            if (resume > cursor) {
+                atomic_fetch_add_explicit(&sink->dropped, resume - cursor, memory_order_relaxed);
+                cursor = resume;
+                atomic_store_explicit(&sink->cursor, cursor, memory_order_release);
+            }
+        } else if (count > 0) {
+            continue;
+        } else if (atomic_load(&pipeline.closing) && cursor >= atomic_load(&pipeline.next_seq)) {
+            break;
+        } else {
+            usleep(1000);  // Idle: nothing published yet
+        }
+    }
+    return NULL;
+}
+
+/* Attach a sink; only valid before pipeline_start() */
+void pipeline_add_sink(EventSink* sink) {
+    if (pipeline.sink_count < MAX_SINKS) {
+        atomic_store(&sink->cursor, 0);
+        atomic_store(&sink->dropped, 0);
+        pipeline.sinks[pipeline.sink_count++] = sink;
+    }
+}
+
+/* Start one consumer thread per attached sink */
+void pipeline_start() {
+    for (int i = 0; i < EVENT_RING_SIZE; i++) {
+        atomic_store(&pipeline.slots[i].sequence, -1);
+    }
+    atomic_store(&pipeline.next_seq, 0);
+    atomic_store(&pipeline.closing, false);
+    for (int i = 0; i < pipeline.sink_count; i++) {
+        pthread_create(&pipeline.sinks[i]->thread, NULL, sink_thread, pipeline.sinks[i]);
+    }
+}
+
+/* Let every sink drain what was emitted, stop them, then run their finish hooks */
+void pipeline_close() {
+    atomic_store(&pipeline.closing, true);
+    for (int i = 0; i < pipeline.sink_count; i++) {
+        pthread_join(pipeline.sinks[i]->thread, NULL);
+    }
+    
+    // Summaries come last, after the narration of every sink has been written
+    for (int i = 0; i < pipeline.sink_count; i++) {
+        if (pipeline.sinks[i]->finish != NULL) {
+            pipeline.sinks[i]->finish(pipeline.sinks[i]);
+        }
+        long dropped = atomic_load(&pipeline.sinks[i]->dropped);
+        if (dropped > 0) {
+            fprintf(stderr, "Sink %s fell behind and dropped %ld events.\n", pipeline.sinks[i]->name, dropped);
+        }
+    }
+}
+
+/* Text sink: the human-readable narration, written off the hot path */
+static void text_sink_consume(EventSink* sink, const BakeryEvent* events, int count) {
+    (void)sink;
+    for (int i = 0; i < count; i++) {
+        const BakeryEvent* e = &events[i];
+        const char* color = e->color == RED ? "RED" : "BLUE";
+        switch (e->type) {
+        case EV_ARRIVE:
+            printf("Customer %d (%s) arrives at Sweet Harmony.\n", e->customer_id, color);
+            break;
+        case EV_QUEUE:
+            printf("Customer %d (%s) waits in line.\n", e->customer_id, color);
+            break;
+        case EV_ENTER:
+            break;  // Narrated together with the seat it leads to
+        case EV_SEAT:
+            printf("Customer %d (%s) enters %sand sits at table %d. Inside: %d red, %d blue\n", 
+                   e->customer_id, color, e->from_queue ? "from queue " : "", 
+                   e->table_id, e->red_inside, e->blue_inside);
+            break;
+        case EV_LEAVE:
+            printf("Customer %d (%s) leaves table %d. Inside: %d red, %d blue\n", 
+                   e->customer_id, color, e->table_id, e->red_inside, e->blue_inside);
+            break;
+        case EV_REJECT:
+            printf("Customer %d (%s) gives up: no table left.\n", e->customer_id, color);
+            break;
+        case EV_CHECKOUT:
+            printf("Customer %d (%s) pays at cashier %d, %.2f s after arriving.\n",
+                   e->customer_id, color, e->table_id, e->wait_us / 1e6);
+            break;
+        case EV_BALK:
+            printf("Customer %d (%s) sees %d of their color in line and walks away.\n",
+                   e->customer_id, color, e->color == RED ? e->red_waiting : e->blue_waiting);
+            break;
+        case EV_RENEGE:
+            printf("Customer %d (%s) runs out of patience after %.2f s in line and leaves.\n",
+                   e->customer_id, color, e->wait_us / 1e6);
+            break;
+        }
+    }
+    fflush(stdout);
+}
+
+/* Binary trace sink: a header followed by raw BakeryEvent records */
+static void trace_sink_consume(EventSink* sink, const BakeryEvent* events, int count) {
+    fwrite(events, sizeof(BakeryEvent), count, (FILE*)sink->state);
+}
+
+static void trace_sink_finish(EventSink* sink) {
+    fclose((FILE*)sink->state);
+}
+
+/* Open the trace file and write its header; false if it cannot be created */
+static bool trace_sink_open(EventSink* sink, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+    uint64_t header[2] = { TRACE_MAGIC, sizeof(BakeryEvent) };
+    fwrite(header, sizeof(header), 1, file);
+    sink->state = file;
+    return true;
+}
+
+/* Stats sink: per-type totals and peak occupancy, printed at shutdown */
+typedef struct {
+    long counts[EV_TYPE_COUNT];
+    int peak_inside;
+    long max_wait_us;
+    long visit_sum_us;           // Arrival to paid, summed over EV_CHECKOUT
+    long renege_sum_us;          // Time in line before giving up, summed over EV_RENEGE
+} EventStats;
+
+static void stats_sink_consume(EventSink* sink, const BakeryEvent* events, int count) {
+    EventStats* stats = (EventStats*)sink->state;
+    for (int i = 0; i < count; i++) {
+        stats->counts[events[i].type]++;
+        if (events[i].customers_inside > stats->peak_inside) {
+            stats->peak_inside = events[i].customers_inside;
+        }
+        if (events[i].type == EV_SEAT && events[i].wait_us > stats->max_wait_us) {
+            stats->max_wait_us = events[i].wait_us;
+        }
+        if (events[i].type == EV_CHECKOUT) {
+            stats->visit_sum_us += events[i].wait_us;
+        }
+        if (events[i].type == EV_RENEGE) {
+            stats->renege_sum_us += events[i].wait_us;
+        }
+    }
+}
+
+static void stats_sink_finish(EventSink* sink) {
+    EventStats* stats = (EventStats*)sink->state;
+    long paid = stats->counts[EV_CHECKOUT];
+    printf("Events: %ld arrive, %ld queue, %ld enter, %ld seat, %ld leave, %ld reject, %ld paid; "
+           "peak inside %d, max wait %.3f s, mean visit %.3f s\n",
+           stats->counts[EV_ARRIVE], stats->counts[EV_QUEUE], stats->counts[EV_ENTER],
+           stats->counts[EV_SEAT], stats->counts[EV_LEAVE], stats->counts[EV_REJECT], paid,
+           stats->peak_inside, stats->max_wait_us / 1e6,
+           paid > 0 ? stats->visit_sum_us / 1e6 / paid : 0.0);
+    long arrived = stats->counts[EV_ARRIVE];
+    long balked = stats->counts[EV_BALK];
+    long reneged = stats->counts[EV_RENEGE];
+    printf("Abandonment: %ld balked, %ld reneged (%.1f%% of arrivals), mean patience spent %.3f s\n",
+           balked, reneged, arrived > 0 ? 100.0 * (balked + reneged) / arrived : 0.0,
+           reneged > 0 ? stats->renege_sum_us / 1e6 / reneged : 0.0);
+}
+
+/* Metrics sink: keeps the scrape-able mirror up to date */
+static void metrics_sink_consume(EventSink* sink, const BakeryEvent* events, int count) {
+    (void)sink;
+    for (int i = 0; i < count; i++) {
+        const BakeryEvent* e = &events[i];
+        switch (e->type) {
+        case EV_ARRIVE:
+            atomic_fetch_add_explicit(&metrics.arrivals, 1, memory_order_relaxed);
+            break;
+        case EV_QUEUE:
+            atomic_fetch_add_explicit(&metrics.queued, 1, memory_order_relaxed);
+            break;
+        case EV_SEAT:
+            record_wait(e->wait_us);
+            break;
+        case EV_LEAVE:
+            atomic_fetch_add_explicit(&metrics.served, 1, memory_order_relaxed);
+            break;
+        case EV_BALK:
+            atomic_fetch_add_explicit(&metrics.balked, 1, memory_order_relaxed);
+            break;
+        case EV_RENEGE:
+            atomic_fetch_add_explicit(&metrics.reneged, 1, memory_order_relaxed);
+            break;
+        default:
+            break;
+        }
+    }
+    publish_gauges(&events[count - 1]);
+}
+
+/* Put a customer in the slot for its tick, relative to the wheel's current time */
+static void wheel_place(Customer* customer) {
+    uint64_t expires = customer->depart_tick;
+    uint64_t delta = expires - wheel.now;
+    int level = 0;
     
-    // Queue structures for waiting customers
-    Customer* red_queue[MAX_CUSTOMERS];
-    int red_queue_front;
-    int red_queue_rear;
-    int red_queue_size;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    if (delta >= (1ULL << (WHEEL_BITS * WHEEL_LEVELS))) {
+        // Beyond the wheel's range: park in the furthest slot and re-cascade later
+        expires = wheel.now + (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    }
+    int slot = (expires >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+    customer->timer_next = wheel.slots[level][slot];
+    wheel.slots[level][slot] = customer;
+}
+
+/* Move one higher-level slot down; returns the slot index that was emptied */
+static int wheel_cascade(int level) {
+    int slot = (wheel.now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+    Customer* list = wheel.slots[level][slot];
+    wheel.slots[level][slot] = NULL;
+    while (list != NULL) {
+        Customer* next = list->timer_next;
+        wheel_place(list);
+        list = next;
+    }
+    return slot;
+}
+
+/* Advance the wheel by one tick and append due customers to *expired; wheel.lock held */
+static void wheel_tick(Customer** expired) {
+    wheel.now++;
     
-    Customer* blue_queue[MAX_CUSTOMERS];
-    int blue_queue_front;
-    int blue_queue_rear;
-    int blue_queue_size;
+    // When a level wraps, pull the next lap of the level above down into it
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        if (((wheel.now >> (WHEEL_BITS * (level - 1))) & (WHEEL_SLOTS - 1)) != 0) {
+            break;
+        }
+        wheel_cascade(level);
+    }
     
-    // Synchronization objects
-    pthread_mutex_t bakery_mutex;    // Protects the bakery state
-    sem_t red_sem;                   // Controls red customer entry
-    sem_t blue_sem;                  // Controls blue customer entry
-    sem_t tables_sem;                // Controls table availability
-    pthread_cond_t balance_cond;     // Signals when color balance changes
-} BakeryState;
+    int slot = wheel.now & (WHEEL_SLOTS - 1);
+    Customer* list = wheel.slots[0][slot];
+    wheel.slots[0][slot] = NULL;
+    while (list != NULL) {
+        Customer* next = list->timer_next;
+        list->timer_next = *expired;
+        *expired = list;
+        list = next;
+    }
+}
 
-/* Global state */
-BakeryState bakery;
+/* Schedule a seated customer's departure after their eating time */
+void schedule_departure(Customer* customer) {
+    pthread_mutex_lock(&wheel.lock);
+    uint64_t ticks = (uint64_t)customer->eating_time * 1000 / WHEEL_TICK_MS;
+    customer->depart_tick = wheel.now + (ticks > 0 ? ticks : 1);
+    wheel_place(customer);
+    wheel.pending++;
+    pthread_mutex_unlock(&wheel.lock);
+}
 
-/* Function prototypes */
-void init_bakery(int total_tables);
-void cleanup_bakery();
-int find_free_table();
-void* customer_behavior(void* arg);
-void enqueue_customer(Customer* customer);
-Customer* dequeue_customer(CustomerColor color);
-bool can_enter(CustomerColor color);
-void try_balance_entry();
+/* Timer thread: each timerfd expiry advances the wheel and fires one batch */
+static void* timer_thread(void* arg) {
+    (void)arg;
+    
+    while (atomic_load(&wheel.running)) {
+        struct pollfd pfd = { .fd = wheel.timer_fd, .events = POLLIN };
+        if (poll(&pfd, 1, 100) <= 0) {
+            continue;  // Timeout: recheck the running flag
+        }
+        uint64_t ticks = 0;
+        if (read(wheel.timer_fd, &ticks, sizeof(ticks)) != sizeof(ticks)) {
+            continue;
+        }
+        
+        // Catch up on every missed tick, then release the wheel before touching the bakery
+        Customer* expired = NULL;
+        int fired = 0;
+        pthread_mutex_lock(&wheel.lock);
+        for (uint64_t t = 0; t < ticks; t++) {
+            wheel_tick(&expired);
+        }
+        pthread_mutex_unlock(&wheel.lock);
+        
+        if (expired == NULL) {
+            continue;
+        }
+        bakery_lock();
+        for (Customer* c = expired; c != NULL; c = c->timer_next) {
+            customer_leave(c);
+            fired++;
+        }
+        bakery_unlock();
+        
+        // Off to pay; the checkout stage frees the customer
+        while (expired != NULL) {
+            Customer* next = expired->timer_next;
+            checkout_dispatch(expired);
+            expired = next;
+        }
+        
+        pthread_mutex_lock(&wheel.lock);
+        wheel.pending -= fired;
+        if (wheel.pending == 0) {
+            pthread_cond_broadcast(&wheel.drained);
+        }
+        pthread_mutex_unlock(&wheel.lock);
+    }
+    return NULL;
+}
 
-/* Initialize bakery state and synchronization objects */
-void init_bakery(int total_tables) {
-    bakery.customers_inside = 0;
-    bakery.red_count = 0;
-    bakery.blue_count = 0;
-    bakery.free_tables = total_tables;
+/* Arm the periodic timerfd and start the timer thread; returns 0 on success */
+int start_timer_wheel(pthread_t* thread) {
+    memset(wheel.slots, 0, sizeof(wheel.slots));
+    wheel.now = 0;
+    wheel.pending = 0;
+    pthread_mutex_init(&wheel.lock, NULL);
+    pthread_cond_init(&wheel.drained, NULL);
     
-    // Initialize table states
-    for (int i = 0; i < MAX_TABLES; i++) {
-        bakery.tables[i] = false;  // All tables start unoccupied
+    wheel.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (wheel.timer_fd < 0) {
+        perror("timerfd_create");
+        return -1;
+    }
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = 0;
+    spec.it_interval.tv_nsec = WHEEL_TICK_MS * 1000000L;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(wheel.timer_fd, 0, &spec, NULL) < 0) {
+        perror("timerfd_settime");
+        close(wheel.timer_fd);
+        return -1;
     }
     
-    // Initialize queues
-    bakery.red_queue_front = 0;
-    bakery.red_queue_rear = -1;
-    bakery.red_queue_size = 0;
+    atomic_store(&wheel.running, true);
+    if (pthread_create(thread, NULL, timer_thread, NULL) != 0) {
+        close(wheel.timer_fd);
+        return -1;
+    }
+    return 0;
+}
+
+/* Wait until every scheduled departure has fired, then stop the timer thread */
+void stop_timer_wheel(pthread_t thread) {
+    pthread_mutex_lock(&wheel.lock);
+    while (wheel.pending > 0) {
+        pthread_cond_wait(&wheel.drained, &wheel.lock);
+    }
+    pthread_mutex_unlock(&wheel.lock);
+    
+    atomic_store(&wheel.running, false);
+    pthread_join(thread, NULL);
+    close(wheel.timer_fd);
+    pthread_mutex_destroy(&wheel.lock);
+    pthread_cond_destroy(&wheel.drained);
+}
+
+/* A customer finishes eating and leaves; caller holds bakery_mutex */
+void customer_leave(Customer* customer) {
+    // Update bakery state
+    if (customer->color == RED) {
+        bakery.red_count--;
+    } else {
+        bakery.blue_count--;
+    }
     
-    bakery.blue_queue_front = 0;
-    bakery.blue_queue_rear = -1;
-    bakery.blue_queue_size = 0;
+    bakery.customers_inside--;
+    bakery.free_tables++;
+    bakery.tables[customer->table_id] = false;
+    emit_event(EV_LEAVE, customer, customer->table_id, false);
     
-    // Initialize synchronization objects
-    pthread_mutex_init(&bakery.bakery_mutex, NULL);
-    sem_init(&bakery.red_sem, 0, 0);  // Start with no permits
-    sem_init(&bakery.blue_sem, 0, 0);  // Start with no permits
-    sem_init(&bakery.tables_sem, 0, total_tables);  // Start with all tables free
-    pthread_cond_init(&bakery.balance_cond, NULL);
+    // Try to let waiting customers in
+    try_balance_entry();
 }
 
-/* Clean up resources */
-void cleanup_bakery() {
-    pthread_mutex_destroy(&bakery.bakery_mutex);
-    sem_destroy(&bakery.red_sem);
-    sem_destroy(&bakery.blue_sem);
-    sem_destroy(&bakery.tables_sem);
-    pthread_cond_destroy(&bakery.balance_cond);
+/* Name of a checkout policy, as accepted in BAKERY_CHECKOUT */
+const char* checkout_policy_name(CheckoutPolicy policy) {
+    static const char* names[CHECKOUT_POLICY_COUNT] = { "shared", "random", "jsq", "p2c" };
+    return names[policy];
 }
 
-/* Find an available table; returns table ID or -1 if none available */
-int find_free_table() {
-    for (int i = 0; i < MAX_TABLES; i++) {
-        if (!bakery.tables[i]) {
-            return i;
+/* The line a cashier serves */
+static CheckoutLine* cashier_line(int cashier) {
+    return &checkout.lines[checkout.policy == CHECKOUT_SHARED ? 0 : cashier];
+}
+
+/* Sleep for a number of microseconds, resuming after signals */
+static void sleep_us(long us) {
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+    while (nanosleep(&ts, &ts) != 0) {
+        // Interrupted: sleep the remainder
+    }
+}
+
+/* Cashier thread: serve the line in order until checkout closes and the line is empty */
+static void* cashier_thread(void* arg) {
+    int cashier = (int)(intptr_t)arg;
+    CheckoutLine* line = cashier_line(cashier);
+    
+    for (;;) {
+        pthread_mutex_lock(&line->lock);
+        while (line->head == NULL && !checkout.closing) {
+            pthread_cond_wait(&line->ready, &line->lock);
+        }
+        Customer* customer = line->head;
+        if (customer == NULL) {
+            pthread_mutex_unlock(&line->lock);
+            break;
+        }
+        line->head = customer->checkout_next;
+        if (line->head == NULL) {
+            line->tail = NULL;
+        }
+        pthread_mutex_unlock(&line->lock);
+        
+        sleep_us(customer->checkout_cost_us);
+        customer->checkout_latency_us = now_us() - customer->checkout_start_us;
+        atomic_fetch_sub_explicit(&line->length, 1, memory_order_relaxed);
+        if (checkout.paid != NULL) {
+            checkout.paid(customer, cashier);
         }
     }
-    return -1;
+    return NULL;
 }
 
-/* Enqueue a customer in their color's queue */
-void enqueue_customer(Customer* customer) {
-    if (customer->color == RED) {
-        bakery.red_queue_rear = (bakery.red_queue_rear + 1) % MAX_CUSTOMERS;
-        bakery.red_queue[bakery.red_queue_rear] = customer;
-        bakery.red_queue_size++;
+/* Start the cashiers; returns 0 on success */
+int start_checkout(int cashiers, CheckoutPolicy policy, void (*paid)(Customer*, int)) {
+    checkout.cashier_count = cashiers;
+    checkout.policy = policy;
+    checkout.closing = false;
+    checkout.paid = paid;
+    for (int i = 0; i < cashiers; i++) {
+        CheckoutLine* line = &checkout.lines[i];
+        atomic_store(&line->length, 0);
+        pthread_mutex_init(&line->lock, NULL);
+        pthread_cond_init(&line->ready, NULL);
+        line->head = NULL;
+        line->tail = NULL;
+    }
+    for (int i = 0; i < cashiers; i++) {
+        if (pthread_create(&checkout.cashiers[i], NULL, cashier_thread, (void*)(intptr_t)i) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Send a customer to a cashier. Line lengths are read with relaxed loads,
+ * so a choice can be based on a slightly stale view; that only costs a
+ * little balance, never correctness, and keeps routing free of locks.
+ */
+void checkout_dispatch(Customer* customer) {
+    int k = checkout.cashier_count;
+    int target = 0;
+    
+    switch (checkout.policy) {
+    case CHECKOUT_SHARED:
+        break;
+    case CHECKOUT_RANDOM:
+        target = rng_next(&customer->rng) % k;
+        break;
+    case CHECKOUT_JSQ: {
+        // Start the scan at a random line so ties do not all go to cashier 0
+        int start = rng_next(&customer->rng) % k;
+        int best = INT32_MAX;
+        for (int i = 0; i < k; i++) {
+            int candidate = (start + i) % k;
+            int length = atomic_load_explicit(&checkout.lines[candidate].length, memory_order_relaxed);
+            if (length < best) {
+                best = length;
+                target = candidate;
+            }
+        }
+        break;
+    }
+    case CHECKOUT_P2C: {
+        int a = rng_next(&customer->rng) % k;
+        int b = k > 1 ? (a + 1 + (int)(rng_next(&customer->rng) % (k - 1))) % k : a;
+        int length_a = atomic_load_explicit(&checkout.lines[a].length, memory_order_relaxed);
+        int length_b = atomic_load_explicit(&checkout.lines[b].length, memory_order_relaxed);
+        target = length_b < length_a ? b : a;
+        break;
+    }
+    default:
+        break;
+    }
+    
+    CheckoutLine* line = &checkout.lines[target];
+    atomic_fetch_add_explicit(&line->length, 1, memory_order_relaxed);
+    customer->checkout_start_us = now_us();
+    customer->checkout_next = NULL;
+    
+    pthread_mutex_lock(&line->lock);
+    if (line->tail != NULL) {
+        line->tail->checkout_next = customer;
     } else {
-        bakery.blue_queue_rear = (bakery.blue_queue_rear + 1) % MAX_CUSTOMERS;
-        bakery.blue_queue[bakery.blue_queue_rear] = customer;
-        bakery.blue_queue_size++;
+        line->head = customer;
     }
+    line->tail = customer;
+    pthread_cond_signal(&line->ready);
+    pthread_mutex_unlock(&line->lock);
 }
 
-/* Dequeue a customer from their color's queue */
-Customer* dequeue_customer(CustomerColor color) {
-    Customer* customer = NULL;
+/* Let the cashiers serve everyone already in line, then stop them */
+void stop_checkout() {
+    int lines = checkout.policy == CHECKOUT_SHARED ? 1 : checkout.cashier_count;
+    for (int i = 0; i < lines; i++) {
+        pthread_mutex_lock(&checkout.lines[i].lock);
+    }
+    checkout.closing = true;
+    for (int i = lines - 1; i >= 0; i--) {
+        pthread_cond_broadcast(&checkout.lines[i].ready);
+        pthread_mutex_unlock(&checkout.lines[i].lock);
+    }
+    for (int i = 0; i < checkout.cashier_count; i++) {
+        pthread_join(checkout.cashiers[i], NULL);
+    }
+    for (int i = 0; i < checkout.cashier_count; i++) {
+        pthread_mutex_destroy(&checkout.lines[i].lock);
+        pthread_cond_destroy(&checkout.lines[i].ready);
+    }
+}
+
+/* Simulation hook: record the payment as an event and release the customer */
+static void customer_paid(Customer* customer, int cashier) {
+    bakery_lock();
+    emit_event(EV_CHECKOUT, customer, cashier, false);
+    bakery_unlock();
+    free(customer);
+}
+
+static int compare_long(const void* a, const void* b) {
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Checkout benchmark: the same open-loop arrival stream (mostly quick
+ * baskets, one in ten a big shop five times as long) is replayed against
+ * every routing policy, and line-join-to-paid latency is compared with
+ * the single shared line.
+ */
+int checkout_bench(long customers, int cashiers) {
+    Customer* pool = malloc(sizeof(Customer) * customers);
+    long* latencies = malloc(sizeof(long) * customers);
+    long* arrival_offset = malloc(sizeof(long) * customers);
+    if (pool == NULL || latencies == NULL || arrival_offset == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
     
-    if (color == RED && bakery.red_queue_size > 0) {
-        customer = bakery.red_queue[bakery.red_queue_front];
-        bakery.red_queue_front = (bakery.red_queue_front + 1) % MAX_CUSTOMERS;
-        bakery.red_queue_size--;
-    } else if (color == BLUE && bakery.blue_queue_size > 0) {
-        customer = bakery.blue_queue[bakery.blue_queue_front];
-        bakery.blue_queue_front = (bakery.blue_queue_front + 1) % MAX_CUSTOMERS;
-        bakery.blue_queue_size--;
+    // Fixed workload: service costs and arrival times do not depend on the policy
+    RngStream workload = rng_stream(1, 0);
+    long mean_cost = BENCH_SERVICE_US * 9 / 10 + BENCH_SERVICE_US * 5 / 10;
+    long mean_gap = (long)(mean_cost / (BENCH_LOAD * cashiers));
+    long offset = 0;
+    long costs_total = 0;
+    for (long i = 0; i < customers; i++) {
+        long cost = BENCH_SERVICE_US / 2 + rng_next(&workload) % BENCH_SERVICE_US;
+        if (rng_next(&workload) % 10 == 0) {
+            cost *= 5;
+        }
+        pool[i].checkout_cost_us = cost;
+        costs_total += cost;
+        arrival_offset[i] = offset;
+        offset += rng_next(&workload) % (2 * mean_gap + 1);
     }
     
-    return customer;
+    printf("Checkout bench: %ld customers, %d cashiers, mean service %.0f us, load %.2f\n\n",
+           customers, cashiers, (double)costs_total / customers, BENCH_LOAD);
+    printf("%-8s %10s %10s %10s %10s %12s %12s\n", "policy", "mean us", "p50 us", "p99 us", "max us",
+           "vs shared", "vs random");
+    
+    double means[CHECKOUT_POLICY_COUNT];
+    for (int policy = 0; policy < CHECKOUT_POLICY_COUNT; policy++) {
+        for (long i = 0; i < customers; i++) {
+            pool[i].id = (int)i;
+            pool[i].rng = rng_stream(2, i);
+        }
+        if (start_checkout(cashiers, (CheckoutPolicy)policy, NULL) != 0) {
+            fprintf(stderr, "Could not start the cashiers.\n");
+            return 1;
+        }
+        long start = now_us();
+        for (long i = 0; i < customers; i++) {
+            long delay = start + arrival_offset[i] - now_us();
+            if (delay > 0) {
+                sleep_us(delay);
+            }
+            checkout_dispatch(&pool[i]);
+        }
+        stop_checkout();
+        
+        double sum = 0.0;
+        for (long i = 0; i < customers; i++) {
+            latencies[i] = pool[i].checkout_latency_us;
+            sum += latencies[i];
+        }
+        qsort(latencies, customers, sizeof(long), compare_long);
+        means[policy] = sum / customers;
+        printf("%-8s %10.0f %10ld %10ld %10ld", checkout_policy_name((CheckoutPolicy)policy), means[policy],
+               latencies[customers / 2], latencies[customers * 99 / 100], latencies[customers - 1]);
+        printf(" %+11.1f%%", 100.0 * (means[CHECKOUT_SHARED] - means[policy]) / means[CHECKOUT_SHARED]);
+        if (policy >= CHECKOUT_RANDOM) {
+            printf(" %+11.1f%%", 100.0 * (means[CHECKOUT_RANDOM] - means[policy]) / means[CHECKOUT_RANDOM]);
+        }
+        printf("\n");
+    }
+    
+    free(pool);
+    free(latencies);
+    free(arrival_offset);
+    return 0;
 }
 
-/* Check if a customer of given color can enter based on balance rule */
-bool can_enter(CustomerColor color) {
-    if (bakery.customers_inside == 0) {
-        // First customer can always enter
-        return true;
+/*
+ * Lane benchmark: time pushes and pops with `waiting` customers in line,
+ * for walk-ins only (the FIFO fast path), for prioritized customers (the
+ * heap), and for a steady state that pops the most urgent customer and
+ * queues a fresh one while the line stays full. Between push and pop every
+ * other customer gives up from wherever they stand, timing lane_remove().
+ * Pops are checked for order.
+ */
+int queue_bench(int waiting) {
+    if (waiting < 1) {
+        fprintf(stderr, "Need at least one waiting customer.\n");
+        return 1;
+    }
+    Customer* customers = calloc(waiting, sizeof(Customer));
+    if (customers == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
     }
+    RngStream rng = rng_stream(1, 0);
+    printf("Queue bench: %d customers waiting in one lane\n\n", waiting);
+    printf("%-12s %12s %12s %12s\n", "workload", "push ns", "cancel ns", "pop ns");
     
-    if (color == RED) {
-        // Red customer can enter if doing so maintains or improves balance
-        return bakery.red_count < bakery.blue_count;
-    } else {
-        // Blue customer can enter if doing so maintains or improves balance
-        return bakery.blue_count < bakery.red_count;
+    for (int prioritized = 0; prioritized <= 1; prioritized++) {
+        WaitLane lane;
+        bool pushed_all = lane_init(&lane, MAX_CUSTOMERS);
+        for (int i = 0; i < waiting; i++) {
+            customers[i].id = i;
+            customers[i].arrival_us = i;
+            customers[i].priority = prioritized ? (int)(rng_next(&rng) % 3) : 0;
+            customers[i].reserve_us = prioritized ? (long)(rng_next(&rng) % 60000000) + 1 : 0;
+        }
+        
+        long start = now_us();
+        for (int i = 0; i < waiting && pushed_all; i++) {
+            pushed_all = lane_push(&lane, &customers[i]);
+        }
+        long pushed = now_us();
+        if (!pushed_all) {
+            fprintf(stderr, "Out of memory.\n");
+            lane_destroy(&lane);
+            free(customers);
+            return 1;
+        }
+        for (int i = 1; i < waiting; i += 2) {
+            lane_remove(&lane, &customers[i]);
+        }
+        long cancelled = now_us();
+        int remaining = lane_size(&lane);
+        bool ordered = remaining == (waiting + 1) / 2;
+        uint64_t last = 0;
+        for (int i = 0; i < remaining; i++) {
+            Customer* c = lane_pop(&lane);
+            uint64_t rank = prioritized ? lane_rank(c) : (uint64_t)c->id;
+            ordered &= rank >= last && c->id % 2 == 0;
+            last = rank;
+        }
+        long popped = now_us();
+        printf("%-12s %12.1f %12.1f %12.1f%s\n", prioritized ? "prioritized" : "walk-ins",
+               (pushed - start) * 1000.0 / waiting,
+               (cancelled - pushed) * 1000.0 / (waiting / 2 > 0 ? waiting / 2 : 1),
+               (popped - cancelled) * 1000.0 / (remaining > 0 ? remaining : 1),
+               ordered ? "" : "  OUT OF ORDER");
+        lane_destroy(&lane);
+    }
+    
+    // Steady state: the line stays at `waiting` while customers come and go
+    WaitLane lane;
+    bool pushed_all = lane_init(&lane, MAX_CUSTOMERS);
+    for (int i = 0; i < waiting && pushed_all; i++) {
+        pushed_all = lane_push(&lane, &customers[i]);
     }
+    long start = now_us();
+    long clock = waiting;
+    for (int i = 0; i < waiting && pushed_all; i++) {
+        Customer* c = lane_pop(&lane);
+        c->arrival_us = clock++;
+        c->reserve_us = (long)(rng_next(&rng) % 60000000) + 1;
+        pushed_all = lane_push(&lane, c);
+    }
+    long elapsed = now_us() - start;
+    if (!pushed_all) {
+        fprintf(stderr, "Out of memory.\n");
+        lane_destroy(&lane);
+        free(customers);
+        return 1;
+    }
+    printf("%-12s %38.1f  (pop + push)\n", "steady", elapsed * 1000.0 / waiting);
+    lane_destroy(&lane);
+    
+    free(customers);
+    return 0;
 }
 
-/* Try to maintain balance by allowing customers to enter */
-void try_balance_entry() {
-    // Check if we can let more customers in to balance colors
-    while (bakery.free_tables > 0) {
-        if (bakery.red_count < bakery.blue_count && bakery.red_queue_size > 0) {
-            // Let a red customer in
-            sem_post(&bakery.red_sem);
-            break;
-        } else if (bakery.blue_count < bakery.red_count && bakery.blue_queue_size > 0) {
-            // Let a blue customer in
-            sem_post(&bakery.blue_sem);
-            break;
-        } else if (bakery.red_count == bakery.blue_count) {
-            // Colors are balanced, we can let either color in
-            if (bakery.red_queue_size > 0) {
-                sem_post(&bakery.red_sem);
-                break;
-            } else if (bakery.blue_queue_size > 0) {
-                sem_post(&bakery.blue_sem);
-                break;
-            } else {
-                // No customers waiting
-                break;
+/* One lock variant behind function pointers, so the bench runs every variant in one binary */
+typedef struct {
+    const char* name;
+    void (*lock)(void* lock);
+    void (*unlock)(void* lock);
+} LockOps;
+
+static void pthread_lock_op(void* lock) { pthread_mutex_lock((pthread_mutex_t*)lock); }
+static void pthread_unlock_op(void* lock) { pthread_mutex_unlock((pthread_mutex_t*)lock); }
+static void adaptive_lock_op(void* lock) { adaptive_lock((AdaptiveLock*)lock); }
+static void adaptive_unlock_op(void* lock) { adaptive_unlock((AdaptiveLock*)lock); }
+static void ticket_lock_op(void* lock) { ticket_lock((TicketLock*)lock); }
+static void ticket_unlock_op(void* lock) { ticket_unlock((TicketLock*)lock); }
+static void mcs_lock_op(void* lock) { mcs_lock((McsLock*)lock); }
+static void mcs_unlock_op(void* lock) { mcs_unlock((McsLock*)lock); }
+
+/* Indexed by BAKERY_LOCK */
+static const LockOps lock_variants[] = {
+    { "pthread", pthread_lock_op, pthread_unlock_op },
+    { "adaptive", adaptive_lock_op, adaptive_unlock_op },
+    { "ticket", ticket_lock_op, ticket_unlock_op },
+    { "mcs", mcs_lock_op, mcs_unlock_op },
+};
+
+/* Counters updated inside the critical section, sized like the bakery's */
+typedef struct {
+    long acquisitions;
+    long inside;
+    long tables;
+} LockBenchShared;
+
+typedef struct {
+    _Alignas(64) const LockOps* ops;
+    void* lock;
+    LockBenchShared* shared;
+    atomic_bool* running;
+    long acquired;
+} LockBenchThread;
+
+static void* lock_bench_thread(void* arg) {
+    LockBenchThread* t = (LockBenchThread*)arg;
+    uint64_t work = (uint64_t)(uintptr_t)t;
+    while (atomic_load_explicit(t->running, memory_order_relaxed)) {
+        t->ops->lock(t->lock);
+        t->shared->acquisitions++;
+        t->shared->inside += 1;
+        t->shared->tables ^= t->shared->inside;
+        t->shared->inside -= 1;
+        t->ops->unlock(t->lock);
+        t->acquired++;
+        
+        // A little work outside the lock, like a customer between transitions
+        for (int i = 0; i < 8; i++) {
+            work = rng_mix(work);
+        }
+    }
+    t->shared->tables += (long)(work & 1);  // Keep the outside work observable
+    return NULL;
+}
+
+/*
+ * Lock bench: threads hammer one lock around a critical section of a few
+ * counter updates (the shape of a bakery transition) for LOCK_BENCH_MS,
+ * for every variant at 2, 4, ... max_threads threads. Reports throughput
+ * in M acquisitions/s and fairness (fewest / most acquisitions by any one
+ * thread), and checks that no update inside the lock was lost.
+ */
+int lock_bench(int max_threads) {
+    int variant_count = (int)(sizeof(lock_variants) / sizeof(lock_variants[0]));
+    bool lost = false;
+    
+    printf("Lock bench: %d ms per cell, %ld CPU(s); engine built with %s (-DBAKERY_LOCK)\n",
+           LOCK_BENCH_MS, sysconf(_SC_NPROCESSORS_ONLN), lock_variants[BAKERY_LOCK].name);
+    printf("M acquisitions/s (fairness min/max)\n\n%-8s", "threads");
+    for (int v = 0; v < variant_count; v++) {
+        printf(" %18s", lock_variants[v].name);
+    }
+    printf("\n");
+    
+    for (int threads = 2; threads <= max_threads; threads *= 2) {
+        printf("%-8d", threads);
+        for (int v = 0; v < variant_count; v++) {
+            pthread_mutex_t mutex;
+            AdaptiveLock adaptive;
+            TicketLock ticket;
+            McsLock mcs;
+            void* locks[] = { &mutex, &adaptive, &ticket, &mcs };
+            pthread_mutex_init(&mutex, NULL);
+            adaptive_lock_init(&adaptive);
+            ticket_lock_init(&ticket);
+            mcs_lock_init(&mcs);
+            
+            LockBenchShared shared = { 0, 0, 0 };
+            atomic_bool running = true;
+            LockBenchThread* workers = aligned_alloc(64, sizeof(LockBenchThread) * threads);
+            pthread_t* tids = malloc(sizeof(pthread_t) * threads);
+            for (int i = 0; i < threads; i++) {
+                workers[i] = (LockBenchThread){ &lock_variants[v], locks[v], &shared, &running, 0 };
+                pthread_create(&tids[i], NULL, lock_bench_thread, &workers[i]);
             }
-        } else {
-            // Can't improve balance right now
-            break;
+            long start = now_us();
+            usleep(LOCK_BENCH_MS * 1000);
+            atomic_store(&running, false);
+            for (int i = 0; i < threads; i++) {
+                pthread_join(tids[i], NULL);
+            }
+            long elapsed = now_us() - start;
+            
+            long total = 0, fewest = LONG_MAX, most = 0;
+            for (int i = 0; i < threads; i++) {
+                total += workers[i].acquired;
+                fewest = workers[i].acquired < fewest ? workers[i].acquired : fewest;
+                most = workers[i].acquired > most ? workers[i].acquired : most;
+            }
+            lost |= shared.acquisitions != total;
+            printf(" %11.2f (%.2f)%s", total / (double)elapsed, most > 0 ? fewest / (double)most : 0.0,
+                   shared.acquisitions != total ? "!" : "");
+            fflush(stdout);
+            
+            pthread_mutex_destroy(&mutex);
+            free(workers);
+            free(tids);
+        }
+        printf("\n");
+    }
+    if (lost) {
+        printf("\n! Updates inside the lock were lost: mutual exclusion is broken.\n");
+    }
+    return lost ? 1 : 0;
+}
+
+/* Wait on the admit semaphore for at most the customer's patience; false on timeout */
+static bool wait_admitted(Customer* customer) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);  // sem_timedwait() deadlines are on the realtime clock
+    long nsec = deadline.tv_nsec + (customer->patience_us % 1000000) * 1000;
+    deadline.tv_sec += customer->patience_us / 1000000 + nsec / 1000000000;
+    deadline.tv_nsec = nsec % 1000000000;
+    
+    while (sem_timedwait(&customer->admit, &deadline) != 0) {
+        if (errno != EINTR) {
+            return false;
         }
     }
+    return true;
 }
 
 /* Customer thread behavior */
@@ -204,11 +2124,11 @@ void* customer_behavior(void* arg) {
     Customer* customer = (Customer*)arg;
     int table_id = -1;
     
-    printf("Customer %d (%s) arrives at Sweet Harmony.\n", 
-           customer->id, customer->color == RED ? "RED" : "BLUE");
+    customer->arrival_us = now_us();
     
     // Try to enter bakery
-    pthread_mutex_lock(&bakery.bakery_mutex);
+    bakery_lock();
+    emit_event(EV_ARRIVE, customer, -1, false);
     
     // Check if customer can enter immediately
     if (bakery.free_tables > 0 && can_enter(customer->color)) {
@@ -220,33 +2140,59 @@ void* customer_behavior(void* arg) {
         }
         
         bakery.customers_inside++;
+        emit_event(EV_ENTER, customer, -1, false);
         bakery.free_tables--;
         table_id = find_free_table();
         bakery.tables[table_id] = true;
         customer->has_table = true;
+        emit_event(EV_SEAT, customer, table_id, false);
         
-        printf("Customer %d (%s) enters and sits at table %d. Inside: %d red, %d blue\n", 
-               customer->id, customer->color == RED ? "RED" : "BLUE", 
-               table_id, bakery.red_count, bakery.blue_count);
-        
-        pthread_mutex_unlock(&bakery.bakery_mutex);
+        bakery_unlock();
+    } else if (lane_size(&bakery.lanes[customer->color]) >= customer->balk_at) {
+        // The line is longer than this customer will put up with
+        emit_event(EV_BALK, customer, -1, false);
+        bakery_unlock();
+        free(customer);
+        return NULL;
     } else {
         // Customer must wait in queue
-        printf("Customer %d (%s) waits in line.\n", 
-               customer->id, customer->color == RED ? "RED" : "BLUE");
-        
-        enqueue_customer(customer);
-        pthread_mutex_unlock(&bakery.bakery_mutex);
+        sem_init(&customer->admit, 0, 0);
+        if (!enqueue_customer(customer)) {
+            // No room to queue them: turned away, as when no table is left
+            emit_event(EV_REJECT, customer, -1, false);
+            bakery_unlock();
+            sem_destroy(&customer->admit);
+            free(customer);
+            return NULL;
+        }
+        emit_event(EV_QUEUE, customer, -1, false);
+        bakery_unlock();
         
-        // Wait for permission to enter
-        if (customer->color == RED) {
-            sem_wait(&bakery.red_sem);
-        } else {
-            sem_wait(&bakery.blue_sem);
+        // Wait until try_balance_entry() takes this customer off the line, or patience runs out
+        if (!wait_admitted(customer)) {
+            bakery_lock();
+            if (customer->in_lane) {
+                lane_remove(&bakery.lanes[customer->color], customer);
+                emit_event(EV_RENEGE, customer, -1, true);
+                bakery_unlock();
+                sem_destroy(&customer->admit);
+                free(customer);
+                return NULL;
+            }
+            // Admitted just as patience ran out: the post is already on its way
+            bakery_unlock();
+            sem_wait(&customer->admit);
         }
+        sem_destroy(&customer->admit);
         
         // Customer is now allowed to enter
-        pthread_mutex_lock(&bakery.bakery_mutex);
+        bakery_lock();
+        if (customer->reserve_us > 0) {
+            bakery.reservations_seated++;
+            if (now_us() - customer->arrival_us > customer->reserve_us) {
+                bakery.reservations_late++;
+            }
+        }
         
         // Validate we have a table (might have changed while waiting)
         if (bakery.free_tables > 0) {
@@ -258,65 +2204,135 @@ void* customer_behavior(void* arg) {
             }
             
             bakery.customers_inside++;
+            emit_event(EV_ENTER, customer, -1, true);
             bakery.free_tables--;
             table_id = find_free_table();
             bakery.tables[table_id] = true;
             customer->has_table = true;
-            
-            printf("Customer %d (%s) enters from queue and sits at table %d. Inside: %d red, %d blue\n", 
-                   customer->id, customer->color == RED ? "RED" : "BLUE", 
-                   table_id, bakery.red_count, bakery.blue_count);
+            emit_event(EV_SEAT, customer, table_id, true);
+        } else {
+            emit_event(EV_REJECT, customer, -1, true);
         }
         
-        pthread_mutex_unlock(&bakery.bakery_mutex);
+        bakery_unlock();
     }
     
-    // Enjoy pastries for some time
+    // Enjoy pastries: the timing wheel fires the departure and frees the customer
     if (customer->has_table) {
-        sleep(customer->eating_time);
-        
-        // Customer leaves
-        pthread_mutex_lock(&bakery.bakery_mutex);
-        
-        // Update bakery state
-        if (customer->color == RED) {
-            bakery.red_count--;
-        } else {
-            bakery.blue_count--;
-        }
-        
-        bakery.customers_inside--;
-        bakery.free_tables++;
-        bakery.tables[table_id] = false;
-        
-        printf("Customer %d (%s) leaves table %d. Inside: %d red, %d blue\n", 
-               customer->id, customer->color == RED ? "RED" : "BLUE", 
-               table_id, bakery.red_count, bakery.blue_count);
-        
-        // Try to let waiting customers in
-        try_balance_entry();
-        
-        pthread_mutex_unlock(&bakery.bakery_mutex);
+        customer->table_id = table_id;
+        schedule_departure(customer);
+    } else {
+        free(customer);
     }
-    
-    free(customer);
     return NULL;
 }
 
 /* Main function - example usage */
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--checkout-bench") == 0) {
+        long customers = argc > 2 ? atol(argv[2]) : 10000;
+        int cashiers = argc > 3 ? atoi(argv[3]) : 4;
+        if (customers < 1 || cashiers < 1 || cashiers > MAX_CASHIERS) {
+            fprintf(stderr, "Usage: %s --checkout-bench [customers] [cashiers 1..%d]\n", argv[0], MAX_CASHIERS);
+            return 1;
+        }
+        return checkout_bench(customers, cashiers);
+    }
+    if (argc > 1 && strcmp(argv[1], "--queue-bench") == 0) {
+        return queue_bench(argc > 2 ? atoi(argv[2]) : 1000000);
+    }
+    if (argc > 1 && strcmp(argv[1], "--lock-bench") == 0) {
+        return lock_bench(argc > 2 ? atoi(argv[2]) : 128);
+    }
+    
     // Initialize the bakery with 5 tables
-    init_bakery(5);
+    if (!init_bakery(5)) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    
+    // Every output is a sink on the event stream
+    EventSink text_sink = { .name = "text", .consume = text_sink_consume };
+    EventStats event_stats = { { 0 }, 0, 0, 0, 0 };
+    EventSink stats_sink = { .name = "stats", .consume = stats_sink_consume,
+                             .finish = stats_sink_finish, .state = &event_stats };
+    EventSink metrics_sink = { .name = "metrics", .consume = metrics_sink_consume };
+    EventSink trace_sink = { .name = "trace", .consume = trace_sink_consume,
+                             .finish = trace_sink_finish };
+    pipeline_add_sink(&text_sink);
+    pipeline_add_sink(&stats_sink);
+    pipeline_add_sink(&metrics_sink);
+    const char* trace_path = getenv("BAKERY_TRACE");
+    if (trace_path != NULL && trace_sink_open(&trace_sink, trace_path)) {
+        pipeline_add_sink(&trace_sink);
+    }
+    pipeline_start();
+    
+    // Serve live metrics while the simulation runs
+    const char* metrics_path = getenv("BAKERY_METRICS_SOCKET");
+    if (metrics_path == NULL) {
+        metrics_path = METRICS_SOCKET_PATH;
+    }
+    pthread_t metrics_tid;
+    bool metrics_started = start_metrics_server(metrics_path, &metrics_tid) == 0;
+    
+    // Departing customers pay at the cashiers
+    CheckoutPolicy policy = CHECKOUT_JSQ;
+    const char* policy_env = getenv("BAKERY_CHECKOUT");
+    for (int p = 0; policy_env != NULL && p < CHECKOUT_POLICY_COUNT; p++) {
+        if (strcmp(policy_env, checkout_policy_name((CheckoutPolicy)p)) == 0) {
+            policy = (CheckoutPolicy)p;
+        }
+    }
+    const char* cashiers_env = getenv("BAKERY_CASHIERS");
+    int cashiers = cashiers_env != NULL ? atoi(cashiers_env) : CHECKOUT_CASHIERS;
+    if (cashiers < 1 || cashiers > MAX_CASHIERS) {
+        cashiers = CHECKOUT_CASHIERS;
+    }
+    if (start_checkout(cashiers, policy, customer_paid) != 0) {
+        fprintf(stderr, "Could not start the cashiers.\n");
+        return 1;
+    }
+    printf("Checkout: %d cashiers, %s routing\n", cashiers, checkout_policy_name(policy));
+    
+    // One timer thread handles every departure
+    pthread_t timer_tid;
+    if (start_timer_wheel(&timer_tid) != 0) {
+        fprintf(stderr, "Could not start the departure timer.\n");
+        return 1;
+    }
     
     pthread_t threads[MAX_CUSTOMERS];
     int customer_count = 20;  // Create 20 customers for simulation
     
+    // Every random choice derives from this seed
+    uint64_t seed = 1;
+    const char* seed_env = getenv("BAKERY_SEED");
+    if (seed_env != NULL) {
+        seed = strtoull(seed_env, NULL, 10);
+    }
+    printf("Seed: %llu\n", (unsigned long long)seed);
+    
+    // Mean patience in line before a customer gives up
+    long patience_us = PATIENCE_S * 1000000L;
+    const char* patience_env = getenv("BAKERY_PATIENCE");
+    if (patience_env != NULL && atof(patience_env) > 0) {
+        patience_us = (long)(atof(patience_env) * 1e6);
+    }
+    
     // Create customers with alternating colors
     for (int i = 0; i < customer_count; i++) {
         Customer* customer = (Customer*)malloc(sizeof(Customer));
         customer->id = i + 1;
         customer->color = i % 2 == 0 ? RED : BLUE;  // Alternate red and blue
-        customer->eating_time = rand() % 5 + 1;     // Random eating time 1-5 seconds
+        customer->rng = rng_stream(seed, customer->id);
+        customer->eating_time = rng_next(&customer->rng) % 5 + 1;  // Random eating time 1-5 seconds
+        customer->checkout_cost_us = (CHECKOUT_MIN_MS +
+            rng_next(&customer->rng) % (CHECKOUT_MAX_MS - CHECKOUT_MIN_MS + 1)) * 1000L;
+        customer->priority = rng_next(&customer->rng) % VIP_SHARE == 0 ? 1 : 0;
+        customer->reserve_us = customer->priority > 0 ? RESERVATION_WINDOW_US : 0;
+        customer->patience_us = patience_us / 2 + (long)(rng_next(&customer->rng) % (uint64_t)(patience_us + 1));
+        customer->balk_at = BALK_MIN + rng_next(&customer->rng) % (BALK_MAX - BALK_MIN + 1);
         customer->has_table = false;
         
         pthread_create(&threads[i], NULL, customer_behavior, (void*)customer);
@@ -325,14 +2341,22 @@ int main() {
         usleep(500000);  // 0.5 seconds
     }
     
-    // Wait for all customer threads to finish
+    // Wait for all customer threads to finish, then for the last departures
     for (int i = 0; i < customer_count; i++) {
         pthread_join(threads[i], NULL);
     }
+    stop_timer_wheel(timer_tid);
+    stop_checkout();
+    pipeline_close();
     
     // Clean up resources
+    if (metrics_started) {
+        stop_metrics_server(metrics_tid, metrics_path);
+    }
     cleanup_bakery();
     
+    printf("Reservations seated from the line: %d, %d of them late\n",
+           bakery.reservations_seated, bakery.reservations_late);
     printf("Sweet Harmony bakery is now closed.\n");
     return 0;
 }
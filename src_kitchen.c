@@ -0,0 +1,392 @@
+/*
+ * Sweet Harmony Bakery - Kitchen Production Pipeline
+ *
+ * Tables are not the only limit on how many customers the bakery serves:
+ * every seated customer first needs a pastry. This program models the
+ * two stages and measures which one is the bottleneck:
+ *
+ *   ovens  --(batches of --batch pastries every --bake-ms)-->  shelf
+ *   shelf  --(one pastry per order)-->  tables  --(--eat-ms)-->  leave
+ *
+ * The shelf is a bounded lock-free MPMC ring (Vyukov): every cell carries
+ * a sequence number, so a baker claims a free cell and a table claims a
+ * full one with a single CAS on its own stage's position; the two
+ * positions sit on separate cache lines. The only counter both stages
+ * update is the shelf occupancy kept for the report. A baker facing a full shelf, or a table
+ * facing an empty one, backs off (yield, then short sleeps) and accounts
+ * that time as blocked.
+ *
+ * Per stage the report gives throughput, the theoretical capacity and the
+ * fraction of time the stage was blocked on the other one: tables starving
+ * for pastries mean the ovens are the bottleneck, ovens stalled on a full
+ * shelf mean the tables are.
+ *
+ * Build: gcc -O2 -Wall -pthread src_kitchen.c -o src_kitchen
+ *
+ * Example: ./src_kitchen --ovens 2 --batch 6 --bake-ms 40 --tables 5 --eat-ms 50
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <time.h>
+
+/* Constants */
+#define MAX_OVENS 64
+#define MAX_TABLES 1024
+#define CACHE_LINE 64
+#define SPIN_TRIES 64            // Yields before a blocked stage starts sleeping
+#define BACKOFF_US 100           // Sleep between retries once blocked
+
+/* One baked pastry */
+typedef struct {
+    long id;
+    int oven;                    // Oven that baked it
+    long baked_us;               // When it reached the shelf
+} Pastry;
+
+/* Shelf cell: sequence == position means free for that lap, position + 1 means full */
+typedef struct {
+    atomic_long sequence;
+    Pastry pastry;
+} ShelfCell;
+
+/* Bounded MPMC ring shared by the ovens and the tables */
+typedef struct {
+    ShelfCell* cells;
+    long mask;                   // Capacity - 1 (capacity is a power of two)
+    _Alignas(CACHE_LINE) atomic_long enqueue_pos;
+    _Alignas(CACHE_LINE) atomic_long dequeue_pos;
+    _Alignas(CACHE_LINE) atomic_long occupancy;
+    atomic_long peak_occupancy;
+} Shelf;
+
+/* Per-thread stage counters, padded so threads do not share lines */
+typedef struct {
+    _Alignas(CACHE_LINE) int index;
+    long items;                  // Pastries baked or customers served
+    long busy_us;                // Time baking or eating
+    long blocked_us;             // Time waiting on the other stage
+    long dwell_us;               // Tables: sum of pastry age when picked up
+} StageStats;
+
+/* Simulation configuration and shared state */
+typedef struct {
+    int ovens;
+    int batch;
+    int bake_ms;
+    int tables;
+    int eat_ms;
+    long customers;
+    Shelf shelf;
+    atomic_long pastries_claimed;   // Pastries assigned to an oven so far
+    atomic_long customers_claimed;  // Customers assigned to a table so far
+    StageStats oven_stats[MAX_OVENS];
+    StageStats table_stats[MAX_TABLES];
+} Kitchen;
+
+/* Function prototypes */
+long now_us();
+void sleep_ms(int ms);
+int shelf_init(Shelf* shelf, long capacity);
+void shelf_destroy(Shelf* shelf);
+bool shelf_try_put(Shelf* shelf, const Pastry* pastry);
+bool shelf_try_take(Shelf* shelf, Pastry* pastry);
+void* oven_thread(void* arg);
+void* table_thread(void* arg);
+void report(Kitchen* k, long elapsed_us);
+
+Kitchen kitchen;
+
+/* Monotonic clock in microseconds */
+long now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+/* Model a fixed amount of work by sleeping */
+void sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0) {
+        // Interrupted: sleep the remainder
+    }
+}
+
+/* Allocate the ring; capacity is rounded up to a power of two of at least 2 */
+int shelf_init(Shelf* shelf, long capacity) {
+    // One cell is too few: the next lap's free sequence would equal the full one
+    long size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    shelf->cells = aligned_alloc(CACHE_LINE, sizeof(ShelfCell) * size);
+    if (shelf->cells == NULL) {
+        return -1;
+    }
+    for (long i = 0; i < size; i++) {
+        atomic_store(&shelf->cells[i].sequence, i);
+    }
+    shelf->mask = size - 1;
+    atomic_store(&shelf->enqueue_pos, 0);
+    atomic_store(&shelf->dequeue_pos, 0);
+    atomic_store(&shelf->occupancy, 0);
+    atomic_store(&shelf->peak_occupancy, 0);
+    return 0;
+}
+
+void shelf_destroy(Shelf* shelf) {
+    free(shelf->cells);
+}
+
+/* Put a pastry on the shelf; false if the shelf is full */
+bool shelf_try_put(Shelf* shelf, const Pastry* pastry) {
+    long pos = atomic_load_explicit(&shelf->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        ShelfCell* cell = &shelf->cells[pos & shelf->mask];
+        long seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        long diff = seq - pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&shelf->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->pastry = *pastry;
+                atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+                break;
+            }
+        } else if (diff < 0) {
+            return false;        // The cell still holds last lap's pastry
+        } else {
+            pos = atomic_load_explicit(&shelf->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    // Occupancy is only for the report; it is not part of the protocol
+    long now = atomic_fetch_add_explicit(&shelf->occupancy, 1, memory_order_relaxed) + 1;
+    long peak = atomic_load_explicit(&shelf->peak_occupancy, memory_order_relaxed);
+    while (now > peak && !atomic_compare_exchange_weak_explicit(&shelf->peak_occupancy, &peak, now,
+                                                                memory_order_relaxed, memory_order_relaxed)) {
+    }
+    return true;
+}
+
+/* Take the oldest pastry off the shelf; false if the shelf is empty */
+bool shelf_try_take(Shelf* shelf, Pastry* pastry) {
+    long pos = atomic_load_explicit(&shelf->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        ShelfCell* cell = &shelf->cells[pos & shelf->mask];
+        long seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        long diff = seq - (pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&shelf->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *pastry = cell->pastry;
+                atomic_store_explicit(&cell->sequence, pos + shelf->mask + 1, memory_order_release);
+                atomic_fetch_sub_explicit(&shelf->occupancy, 1, memory_order_relaxed);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;        // Nothing baked into this cell yet
+        } else {
+            pos = atomic_load_explicit(&shelf->dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+/* Oven: bake a batch, then shelve it pastry by pastry */
+void* oven_thread(void* arg) {
+    StageStats* stats = (StageStats*)arg;
+    Kitchen* k = &kitchen;
+
+    for (;;) {
+        // Claim the next batch; the last one may be short
+        long first = atomic_fetch_add(&k->pastries_claimed, k->batch);
+        if (first >= k->customers) {
+            break;
+        }
+        long count = k->customers - first < k->batch ? k->customers - first : k->batch;
+
+        long start = now_us();
+        sleep_ms(k->bake_ms);
+        stats->busy_us += now_us() - start;
+
+        long baked = now_us();
+        for (long i = 0; i < count; i++) {
+            Pastry pastry = { first + i, stats->index, baked };
+            long blocked_since = 0;
+            for (int tries = 0; !shelf_try_put(&k->shelf, &pastry); tries++) {
+                if (blocked_since == 0) {
+                    blocked_since = now_us();
+                }
+                if (tries < SPIN_TRIES) {
+                    sched_yield();
+                } else {
+                    usleep(BACKOFF_US);
+                }
+            }
+            if (blocked_since != 0) {
+                stats->blocked_us += now_us() - blocked_since;
+            }
+            stats->items++;
+        }
+    }
+    return NULL;
+}
+
+/* Table: seat the next customer, wait for their pastry, let them eat */
+void* table_thread(void* arg) {
+    StageStats* stats = (StageStats*)arg;
+    Kitchen* k = &kitchen;
+
+    while (atomic_fetch_add(&k->customers_claimed, 1) < k->customers) {
+        // The order is placed on sitting down; eating starts once a pastry is served
+        Pastry pastry;
+        long blocked_since = 0;
+        for (int tries = 0; !shelf_try_take(&k->shelf, &pastry); tries++) {
+            if (blocked_since == 0) {
+                blocked_since = now_us();
+            }
+            if (tries < SPIN_TRIES) {
+                sched_yield();
+            } else {
+                usleep(BACKOFF_US);
+            }
+        }
+        long served = now_us();
+        if (blocked_since != 0) {
+            stats->blocked_us += served - blocked_since;
+        }
+        stats->dwell_us += served - pastry.baked_us;
+
+        sleep_ms(k->eat_ms);
+        stats->busy_us += now_us() - served;
+        stats->items++;
+    }
+    return NULL;
+}
+
+/* Sum a stage's counters and print its line; returns the blocked fraction */
+static double report_stage(const char* name, StageStats* stats, int count, long elapsed_us,
+                           double capacity_per_s) {
+    long items = 0, busy = 0, blocked = 0;
+    for (int i = 0; i < count; i++) {
+        items += stats[i].items;
+        busy += stats[i].busy_us;
+        blocked += stats[i].blocked_us;
+    }
+    double wall = (double)elapsed_us * count;
+    double blocked_frac = blocked / wall;
+    printf("%-8s %10ld %12.1f %12.1f %9.1f%% %9.1f%%\n", name, items, items / (elapsed_us / 1e6),
+           capacity_per_s, 100.0 * busy / wall, 100.0 * blocked_frac);
+    return blocked_frac;
+}
+
+/* Per-stage throughput, utilization and the bottleneck verdict */
+void report(Kitchen* k, long elapsed_us) {
+    double oven_capacity = (double)k->ovens * k->batch * 1000.0 / k->bake_ms;
+    double table_capacity = (double)k->tables * 1000.0 / k->eat_ms;
+
+    printf("%-8s %10s %12s %12s %10s %10s\n", "stage", "items", "items/s", "capacity/s", "busy", "blocked");
+    double ovens_blocked = report_stage("ovens", k->oven_stats, k->ovens, elapsed_us, oven_capacity);
+    double tables_blocked = report_stage("tables", k->table_stats, k->tables, elapsed_us, table_capacity);
+
+    long dwell = 0;
+    for (int i = 0; i < k->tables; i++) {
+        dwell += k->table_stats[i].dwell_us;
+    }
+    printf("\nShelf: capacity %ld, peak %ld, mean pastry age when served %.1f ms\n",
+           k->shelf.mask + 1, atomic_load(&k->shelf.peak_occupancy), dwell / 1000.0 / k->customers);
+    printf("End-to-end: %ld customers in %.2f s (%.1f customers/s)\n",
+           k->customers, elapsed_us / 1e6, k->customers / (elapsed_us / 1e6));
+
+    if (tables_blocked > ovens_blocked) {
+        printf("Bottleneck: ovens (tables spent %.1f%% of their time waiting for pastries)\n",
+               100.0 * tables_blocked);
+    } else {
+        printf("Bottleneck: tables (ovens spent %.1f%% of their time on a full shelf)\n",
+               100.0 * ovens_blocked);
+    }
+}
+
+/* Main function - run the kitchen and table stages to completion */
+int main(int argc, char* argv[]) {
+    Kitchen* k = &kitchen;
+    long shelf_capacity = 16;
+    k->ovens = 2;
+    k->batch = 6;
+    k->bake_ms = 40;
+    k->tables = 5;
+    k->eat_ms = 50;
+    k->customers = 1000;
+
+    for (int i = 1; i < argc; i++) {
+        const char* val = i + 1 < argc ? argv[i + 1] : "";
+        if (strcmp(argv[i], "--ovens") == 0) {
+            k->ovens = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            k->batch = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--bake-ms") == 0) {
+            k->bake_ms = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--tables") == 0) {
+            k->tables = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--eat-ms") == 0) {
+            k->eat_ms = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--shelf") == 0) {
+            shelf_capacity = atol(val);
+            i++;
+        } else if (strcmp(argv[i], "--customers") == 0) {
+            k->customers = atol(val);
+            i++;
+        } else {
+            fprintf(stderr, "Usage: %s [--ovens N] [--batch N] [--bake-ms MS] [--tables N] "
+                    "[--eat-ms MS] [--shelf N] [--customers N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (k->ovens < 1 || k->ovens > MAX_OVENS || k->tables < 1 || k->tables > MAX_TABLES ||
+        k->batch < 1 || k->bake_ms < 1 || k->eat_ms < 1 || shelf_capacity < 1 || k->customers < 1) {
+        fprintf(stderr, "Need 1..%d ovens, 1..%d tables and positive batch, times, shelf and customers.\n",
+                MAX_OVENS, MAX_TABLES);
+        return 1;
+    }
+    if (shelf_init(&k->shelf, shelf_capacity) != 0) {
+        fprintf(stderr, "Could not allocate the shelf.\n");
+        return 1;
+    }
+
+    printf("%d ovens x %d pastries / %d ms, %d tables x %d ms, shelf %ld, %ld customers\n\n",
+           k->ovens, k->batch, k->bake_ms, k->tables, k->eat_ms, k->shelf.mask + 1, k->customers);
+
+    pthread_t ovens[MAX_OVENS];
+    pthread_t tables[MAX_TABLES];
+    long start = now_us();
+    for (int i = 0; i < k->ovens; i++) {
+        k->oven_stats[i].index = i;
+        pthread_create(&ovens[i], NULL, oven_thread, &k->oven_stats[i]);
+    }
+    for (int i = 0; i < k->tables; i++) {
+        k->table_stats[i].index = i;
+        pthread_create(&tables[i], NULL, table_thread, &k->table_stats[i]);
+    }
+    for (int i = 0; i < k->ovens; i++) {
+        pthread_join(ovens[i], NULL);
+    }
+    for (int i = 0; i < k->tables; i++) {
+        pthread_join(tables[i], NULL);
+    }
+    long elapsed = now_us() - start;
+
+    report(k, elapsed);
+    shelf_destroy(&k->shelf);
+    return 0;
+}
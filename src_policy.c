@@ -0,0 +1,354 @@
+/*
+ * Sweet Harmony Bakery - Admission Policy Engine and Benchmark
+ *
+ * Every variant of the bakery hard-codes its own balance rule:
+ *   Final_2.c, src_ds.c, src_des.c   own < other (or the bakery is empty)
+ *   src_GUI01.c                      own <= other
+ * Both are instances of one policy family:
+ *
+ *   a customer may enter if own + 1 - other <= tolerance (or nobody is
+ *   inside), and own < cap[color]
+ *
+ * tolerance 0 is the strict rule and tolerance 1 is the src_GUI01.c rule.
+ * Larger tolerances allow |R - B| <= k. Caps bound each color.
+ *
+ * Policies are fixed at compile time. DEFINE_POLICY() instantiates the
+ * whole admission kernel for one set of constants, so the rule check is
+ * inlined and folded into each kernel. The benchmark replays one workload
+ * through every specialized kernel and through two runtime-dispatched ones
+ * (a switch on a policy reloaded at every check, and a function pointer).
+ * It checks that all three make identical decisions and reports each
+ * kernel's median throughput over --reps interleaved runs together with
+ * the spread (max - min as a percentage of the median). Inlining usually
+ * wins, but by a margin that depends on the policy and the machine; where
+ * the gap is inside the spread the kernels are indistinguishable.
+ *
+ * Scope: this is a standalone benchmark of the rule, not a shared engine.
+ * The kernels model exactly two colors (RED, BLUE), and none of the
+ * simulators calls into them; each still carries its own hard-coded check.
+ *
+ * Build: gcc -O2 -Wall src_policy.c -o src_policy
+ *
+ * Example: ./src_policy --ops 50000000 --tables 16 --reps 7
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+/* Constants */
+#define NO_CAP 0x7FFFFFFF        // Cap value meaning "unbounded"
+#define MAX_TABLES 4096          // Seated-customer ring capacity
+#define ARRIVALS_PER_DEPARTURE 3 // Workload mix: arrivals outnumber departures
+#define MAX_REPS 64              // Upper bound on --reps
+
+/* Color enumeration */
+typedef enum {
+    RED = 0,
+    BLUE = 1
+} CustomerColor;
+
+/* Runtime description of a policy (used by the dispatched kernels and for printing) */
+typedef enum {
+    POLICY_STRICT = 0,           // tolerance 0
+    POLICY_NOT_AHEAD,            // tolerance 1
+    POLICY_TOLERANCE,            // tolerance k
+    POLICY_CAPPED,               // tolerance k plus per-color caps
+    POLICY_KIND_COUNT
+} PolicyKind;
+
+typedef struct {
+    PolicyKind kind;
+    const char* name;
+    int tolerance;
+    int cap[2];
+} AdmissionPolicy;
+
+/* One pre-generated operation: an arrival of a color, or the oldest diner leaving */
+typedef struct {
+    uint8_t* ops;                // 0 = red arrives, 1 = blue arrives, 2 = departure
+    long count;
+    int tables;
+} Workload;
+
+/* Outcome of a replay; equal results mean equal decisions */
+typedef struct {
+    long admitted[2];
+    long peak_imbalance;
+    uint64_t digest;             // Order-sensitive hash of every admission
+    double seconds;
+} ReplayResult;
+
+/* Model state shared by all kernels */
+typedef struct {
+    int inside[2];
+    long waiting[2];
+    int free_tables;
+    uint8_t seated[MAX_TABLES];  // FIFO of seated colors
+    int seated_head;
+    int seated_count;
+} BakeryModel;
+
+typedef bool (*AllowsFn)(const AdmissionPolicy* policy, const int inside[2], int color);
+
+/* Function prototypes */
+void make_workload(Workload* w, long count, int tables, uint64_t seed);
+ReplayResult replay_switch(const Workload* w);
+ReplayResult replay_pointer(const Workload* w, const AdmissionPolicy* policy, AllowsFn allows);
+bool allows_dynamic(const AdmissionPolicy* policy, const int inside[2], int color);
+
+/* The rule itself; with constant arguments it folds to one or two compares */
+static inline __attribute__((always_inline))
+bool policy_allows(const int inside[2], int color, int tolerance, int cap_red, int cap_blue) {
+    int own = inside[color];
+    int other = inside[color ^ 1];
+    if (own >= (color == RED ? cap_red : cap_blue)) {
+        return false;
+    }
+    return own + other == 0 || own + 1 - other <= tolerance;
+}
+
+static double wall_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static inline void model_seat(BakeryModel* m, ReplayResult* r, int color, long op) {
+    m->inside[color]++;
+    m->free_tables--;
+    m->seated[(m->seated_head + m->seated_count) % MAX_TABLES] = color;
+    m->seated_count++;
+    r->admitted[color]++;
+    r->digest = (r->digest ^ (uint64_t)(op * 2 + color)) * 0x100000001B3ULL;
+    long imbalance = labs((long)m->inside[RED] - m->inside[BLUE]);
+    if (imbalance > r->peak_imbalance) {
+        r->peak_imbalance = imbalance;
+    }
+}
+
+/*
+ * The admission kernel, written once. ALLOWS(inside, color) is the policy
+ * check; each instantiation gets its own copy with the check inlined.
+ *   arrival:   join the line; walk straight in if the line is empty and
+ *              the policy and a free table allow it
+ *   departure: free the oldest table, then admit from the lines, always
+ *              trying the color with fewer customers inside first
+ */
+#define REPLAY_KERNEL(ALLOWS)                                                   \
+    ReplayResult r;                                                             \
+    BakeryModel m;                                                              \
+    memset(&r, 0, sizeof(r));                                                   \
+    memset(&m, 0, sizeof(m));                                                   \
+    r.digest = 0xCBF29CE484222325ULL;                                           \
+    m.free_tables = w->tables;                                                  \
+    double start = wall_clock();                                                \
+    for (long op = 0; op < w->count; op++) {                                    \
+        int kind = w->ops[op];                                                  \
+        if (kind < 2) {                                                         \
+            if (m.waiting[kind] == 0 && m.free_tables > 0 && ALLOWS(m.inside, kind)) { \
+                model_seat(&m, &r, kind, op);                                   \
+            } else {                                                            \
+                m.waiting[kind]++;                                              \
+            }                                                                   \
+            continue;                                                           \
+        }                                                                       \
+        if (m.seated_count == 0) {                                              \
+            continue;                                                           \
+        }                                                                       \
+        int leaving = m.seated[m.seated_head];                                  \
+        m.seated_head = (m.seated_head + 1) % MAX_TABLES;                       \
+        m.seated_count--;                                                       \
+        m.inside[leaving]--;                                                    \
+        m.free_tables++;                                                        \
+        while (m.free_tables > 0) {                                             \
+            int first = m.inside[RED] <= m.inside[BLUE] ? RED : BLUE;           \
+            if (m.waiting[first] > 0 && ALLOWS(m.inside, first)) {              \
+                m.waiting[first]--;                                             \
+                model_seat(&m, &r, first, op);                                  \
+            } else if (m.waiting[first ^ 1] > 0 && ALLOWS(m.inside, first ^ 1)) { \
+                m.waiting[first ^ 1]--;                                         \
+                model_seat(&m, &r, first ^ 1, op);                              \
+            } else {                                                            \
+                break;                                                          \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+    r.seconds = wall_clock() - start;                                           \
+    return r;
+
+/* Instantiate a compile-time policy: NAME_allows() and replay_NAME() */
+#define DEFINE_POLICY(NAME, TOLERANCE, CAP_RED, CAP_BLUE)                       \
+    static inline __attribute__((always_inline))                               \
+    bool NAME##_allows(const int inside[2], int color) {                        \
+        return policy_allows(inside, color, TOLERANCE, CAP_RED, CAP_BLUE);      \
+    }                                                                           \
+    static __attribute__((noinline)) ReplayResult replay_##NAME(const Workload* w) { \
+        REPLAY_KERNEL(NAME##_allows)                                            \
+    }
+
+DEFINE_POLICY(strict, 0, NO_CAP, NO_CAP)
+DEFINE_POLICY(not_ahead, 1, NO_CAP, NO_CAP)
+DEFINE_POLICY(tolerance3, 3, NO_CAP, NO_CAP)
+DEFINE_POLICY(capped, 2, 6, 4)
+
+/* The same policies as data, for the runtime-dispatched kernels */
+static const AdmissionPolicy policies[POLICY_KIND_COUNT] = {
+    { POLICY_STRICT, "strict (k=0)", 0, { NO_CAP, NO_CAP } },
+    { POLICY_NOT_AHEAD, "not-ahead (k=1)", 1, { NO_CAP, NO_CAP } },
+    { POLICY_TOLERANCE, "tolerance k=3", 3, { NO_CAP, NO_CAP } },
+    { POLICY_CAPPED, "k=2, caps 6/4", 2, { 6, 4 } },
+};
+
+static ReplayResult (*const specialized[POLICY_KIND_COUNT])(const Workload*) = {
+    replay_strict, replay_not_ahead, replay_tolerance3, replay_capped,
+};
+
+/*
+ * Active policy of the switch kernel, reloaded on every check as if it could be
+ * swapped at any moment (a hot-reloaded configuration). Passing the policy as a
+ * plain argument would let the compiler unswitch the loop on the invariant kind
+ * and rebuild the specialized kernels, which measures nothing.
+ */
+static const AdmissionPolicy* volatile active_policy;
+
+/* Runtime check that branches on the policy kind on every call */
+static inline bool switch_allows(const AdmissionPolicy* policy, const int inside[2], int color) {
+    switch (policy->kind) {
+    case POLICY_STRICT:
+        return inside[color] < inside[color ^ 1] || inside[0] + inside[1] == 0;
+    case POLICY_NOT_AHEAD:
+        return inside[color] <= inside[color ^ 1];
+    case POLICY_TOLERANCE:
+        return inside[color] + 1 - inside[color ^ 1] <= policy->tolerance || inside[0] + inside[1] == 0;
+    case POLICY_CAPPED:
+        return inside[color] < policy->cap[color] &&
+               (inside[color] + 1 - inside[color ^ 1] <= policy->tolerance || inside[0] + inside[1] == 0);
+    default:
+        return false;
+    }
+}
+
+/* Runtime check reached through a function pointer; kept out of line on purpose */
+__attribute__((noinline))
+bool allows_dynamic(const AdmissionPolicy* policy, const int inside[2], int color) {
+    return policy_allows(inside, color, policy->tolerance, policy->cap[RED], policy->cap[BLUE]);
+}
+
+__attribute__((noinline))
+ReplayResult replay_switch(const Workload* w) {
+#define SWITCH_ALLOWS(inside, color) switch_allows(active_policy, inside, color)
+    REPLAY_KERNEL(SWITCH_ALLOWS)
+#undef SWITCH_ALLOWS
+}
+
+__attribute__((noinline))
+ReplayResult replay_pointer(const Workload* w, const AdmissionPolicy* policy, AllowsFn allows) {
+#define POINTER_ALLOWS(inside, color) allows(policy, inside, color)
+    REPLAY_KERNEL(POINTER_ALLOWS)
+#undef POINTER_ALLOWS
+}
+
+/* Random arrivals of both colors interleaved with departures */
+void make_workload(Workload* w, long count, int tables, uint64_t seed) {
+    w->ops = malloc(count);
+    w->count = count;
+    w->tables = tables;
+    uint64_t x = seed | 1;
+    for (long i = 0; i < count; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        int roll = (int)(x % (ARRIVALS_PER_DEPARTURE + 1));
+        w->ops[i] = roll == 0 ? 2 : (uint8_t)((x >> 32) & 1);
+    }
+}
+
+static bool same_decisions(const ReplayResult* a, const ReplayResult* b) {
+    return a->digest == b->digest && a->admitted[RED] == b->admitted[RED] &&
+           a->admitted[BLUE] == b->admitted[BLUE];
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Median of n rates, and their spread (max - min) as a percentage of it; sorts rates */
+static double median_rate(double* rates, int n, double* spread_pct) {
+    qsort(rates, n, sizeof(double), compare_doubles);
+    double median = n % 2 ? rates[n / 2] : (rates[n / 2 - 1] + rates[n / 2]) / 2;
+    *spread_pct = median > 0 ? 100.0 * (rates[n - 1] - rates[0]) / median : 0.0;
+    return median;
+}
+
+/* Main function - benchmark driver */
+int main(int argc, char* argv[]) {
+    long ops = 50000000;
+    int tables = 16;
+    int reps = 5;
+
+    for (int i = 1; i < argc; i++) {
+        const char* val = i + 1 < argc ? argv[i + 1] : "";
+        if (strcmp(argv[i], "--ops") == 0) {
+            ops = atol(val);
+            i++;
+        } else if (strcmp(argv[i], "--tables") == 0) {
+            tables = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--reps") == 0) {
+            reps = atoi(val);
+            i++;
+        } else {
+            fprintf(stderr, "Usage: %s [--ops N] [--tables N] [--reps N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (ops < 1 || tables < 1 || tables > MAX_TABLES || reps < 1 || reps > MAX_REPS) {
+        fprintf(stderr, "Need --ops >= 1, --tables in 1..%d and --reps in 1..%d.\n", MAX_TABLES, MAX_REPS);
+        return 1;
+    }
+
+    Workload w;
+    make_workload(&w, ops, tables, 0x2545F4914F6CDD1DULL);
+    printf("%ld operations, %d tables; median of %d runs (spread: max - min, %% of median)\n\n",
+           ops, tables, reps);
+    printf("%-18s %19s %19s %19s %10s %10s %8s\n", "policy", "inlined M/s", "switch M/s",
+           "pointer M/s", "admitted", "peak |R-B|", "match");
+
+    bool all_match = true;
+    for (int p = 0; p < POLICY_KIND_COUNT; p++) {
+        double fixed_rate[MAX_REPS], branched_rate[MAX_REPS], pointer_rate[MAX_REPS];
+        ReplayResult fixed;
+        bool match = true;
+        active_policy = &policies[p];
+
+        // Interleave the kernels so drift in clock speed hits all three alike
+        for (int rep = 0; rep < reps; rep++) {
+            fixed = specialized[p](&w);
+            ReplayResult branched = replay_switch(&w);
+            ReplayResult pointer = replay_pointer(&w, &policies[p], allows_dynamic);
+            match = match && same_decisions(&fixed, &branched) && same_decisions(&fixed, &pointer);
+            fixed_rate[rep] = ops / fixed.seconds / 1e6;
+            branched_rate[rep] = ops / branched.seconds / 1e6;
+            pointer_rate[rep] = ops / pointer.seconds / 1e6;
+        }
+        all_match = all_match && match;
+
+        double fixed_spread, branched_spread, pointer_spread;
+        double fixed_median = median_rate(fixed_rate, reps, &fixed_spread);
+        double branched_median = median_rate(branched_rate, reps, &branched_spread);
+        double pointer_median = median_rate(pointer_rate, reps, &pointer_spread);
+        printf("%-18s %11.1f (%4.1f%%) %11.1f (%4.1f%%) %11.1f (%4.1f%%) %10ld %10ld %8s\n",
+               policies[p].name, fixed_median, fixed_spread, branched_median, branched_spread,
+               pointer_median, pointer_spread,
+               fixed.admitted[RED] + fixed.admitted[BLUE], fixed.peak_imbalance,
+               match ? "yes" : "NO");
+    }
+
+    free(w.ops);
+    return all_match ? 0 : 1;
+}
@@ -0,0 +1,589 @@
+/*
+ * Sweet Harmony Bakery - Batch Statistics over Customer Records
+ *
+ * Reads the columnar record file written by `src_des --records FILE` (or
+ * generates synthetic records) and computes, per outfit color:
+ *   - number of visits, sums of queue wait and table time
+ *   - min/max queue wait
+ *   - a queue-wait histogram
+ * plus occupancy per time window over the whole run.
+ *
+ * The per-block kernel has AVX2, SSE4.2 and scalar versions. The fastest
+ * one the CPU supports is picked at startup (override with --impl).
+ *
+ * Build: gcc -O2 -Wall src_stats.c -o src_stats
+ *
+ * Examples:
+ *   ./src_des --customers 10000000 --records day.rec && ./src_stats day.rec
+ *   ./src_stats --synthetic 100000000 --bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <immintrin.h>
+
+/* Constants */
+#define RECORD_MAGIC 0x3143455254455753ULL  // Must match src_des.c
+#define HIST_BINS 64             // Queue-wait histogram bins
+#define HIST_SHIFT 20            // Bin width is 2^20 us (~1.05 s)
+#define WINDOW_US 60000000LL     // Occupancy window: one virtual minute
+#define MAX_WINDOWS (1 << 22)    // Occupancy windows kept (~8 years of minutes)
+#define SYNTH_BLOCK 65536        // Records per synthetic block
+
+/* Color enumeration */
+typedef enum {
+    RED = 0,
+    BLUE = 1
+} CustomerColor;
+
+/* One columnar block of records */
+typedef struct {
+    int64_t count;
+    int64_t* arrival;
+    int64_t* seat;
+    int64_t* leave;
+    uint8_t* color;
+} RecordBlock;
+
+/* Running aggregates; blocks are folded in one after another */
+typedef struct {
+    int64_t count[2];
+    int64_t wait_sum[2];
+    int64_t stay_sum[2];
+    int64_t wait_min[2];
+    int64_t wait_max[2];
+    int64_t hist[2][HIST_BINS];
+    int32_t* occupancy_delta;    // +1 at the seat window, -1 at the leave window
+    int64_t last_window;
+} StatsAccum;
+
+/* Kernel signature shared by every implementation */
+typedef void (*StatsKernel)(StatsAccum* acc, const RecordBlock* block);
+
+/* Function prototypes */
+void init_accum(StatsAccum* acc);
+void stats_scalar(StatsAccum* acc, const RecordBlock* block);
+void stats_sse42(StatsAccum* acc, const RecordBlock* block);
+void stats_avx2(StatsAccum* acc, const RecordBlock* block);
+void add_occupancy(StatsAccum* acc, const RecordBlock* block);
+StatsKernel pick_kernel(const char* name, const char** chosen);
+void print_report(const StatsAccum* acc);
+
+/* Reset all aggregates */
+void init_accum(StatsAccum* acc) {
+    int32_t* delta = acc->occupancy_delta;
+    memset(acc, 0, sizeof(*acc));
+    acc->occupancy_delta = delta;
+    memset(acc->occupancy_delta, 0, sizeof(int32_t) * (MAX_WINDOWS + 1));
+    acc->last_window = -1;
+    for (int c = 0; c < 2; c++) {
+        acc->wait_min[c] = INT64_MAX;
+        acc->wait_max[c] = INT64_MIN;
+    }
+}
+
+/* Histogram bin for a queue wait */
+static inline int64_t wait_bin(int64_t wait) {
+    int64_t bin = wait >> HIST_SHIFT;
+    return bin < HIST_BINS - 1 ? bin : HIST_BINS - 1;
+}
+
+/*
+ * Occupancy is a scatter (difference array over windows), which SIMD does
+ * not help with, so every kernel shares this loop.
+ */
+void add_occupancy(StatsAccum* acc, const RecordBlock* block) {
+    for (int64_t i = 0; i < block->count; i++) {
+        int64_t in = block->seat[i] / WINDOW_US;
+        int64_t out = block->leave[i] / WINDOW_US;
+        if (in >= MAX_WINDOWS) {
+            continue;
+        }
+        if (out >= MAX_WINDOWS) {
+            out = MAX_WINDOWS;
+        }
+        acc->occupancy_delta[in]++;
+        acc->occupancy_delta[out]--;
+        if (out > acc->last_window) {
+            acc->last_window = out;
+        }
+    }
+}
+
+/* Reference implementation; also handles the tails of the vector kernels */
+static void stats_scalar_range(StatsAccum* acc, const RecordBlock* block, int64_t start) {
+    for (int64_t i = start; i < block->count; i++) {
+        int c = block->color[i];
+        int64_t wait = block->seat[i] - block->arrival[i];
+        acc->count[c]++;
+        acc->wait_sum[c] += wait;
+        acc->stay_sum[c] += block->leave[i] - block->seat[i];
+        if (wait < acc->wait_min[c]) {
+            acc->wait_min[c] = wait;
+        }
+        if (wait > acc->wait_max[c]) {
+            acc->wait_max[c] = wait;
+        }
+        acc->hist[c][wait_bin(wait)]++;
+    }
+}
+
+void stats_scalar(StatsAccum* acc, const RecordBlock* block) {
+    stats_scalar_range(acc, block, 0);
+    add_occupancy(acc, block);
+}
+
+/* SSE4.2: two records per step (64-bit compares need SSE4.2) */
+__attribute__((target("sse4.2")))
+void stats_sse42(StatsAccum* acc, const RecordBlock* block) {
+    const __m128i max_bin = _mm_set1_epi64x(HIST_BINS - 1);
+    __m128i red_wait = _mm_setzero_si128(), all_wait = _mm_setzero_si128();
+    __m128i red_stay = _mm_setzero_si128(), all_stay = _mm_setzero_si128();
+    __m128i red_n = _mm_setzero_si128();
+    __m128i min_r = _mm_set1_epi64x(INT64_MAX), min_b = min_r;
+    __m128i max_r = _mm_set1_epi64x(INT64_MIN), max_b = max_r;
+    int64_t n = block->count & ~(int64_t)1;
+    int64_t bins[2];
+
+    for (int64_t i = 0; i < n; i += 2) {
+        __m128i arrival = _mm_loadu_si128((const __m128i*)(block->arrival + i));
+        __m128i seat = _mm_loadu_si128((const __m128i*)(block->seat + i));
+        __m128i leave = _mm_loadu_si128((const __m128i*)(block->leave + i));
+        uint16_t colors;
+        memcpy(&colors, block->color + i, sizeof(colors));
+        __m128i is_red = _mm_cmpeq_epi64(_mm_cvtepu8_epi64(_mm_cvtsi32_si128(colors)),
+                                         _mm_setzero_si128());
+
+        __m128i wait = _mm_sub_epi64(seat, arrival);
+        __m128i stay = _mm_sub_epi64(leave, seat);
+        all_wait = _mm_add_epi64(all_wait, wait);
+        all_stay = _mm_add_epi64(all_stay, stay);
+        red_wait = _mm_add_epi64(red_wait, _mm_and_si128(wait, is_red));
+        red_stay = _mm_add_epi64(red_stay, _mm_and_si128(stay, is_red));
+        red_n = _mm_sub_epi64(red_n, is_red);  // Mask lanes are -1
+
+        // Per-color min/max: lanes of the other color are left unchanged
+        __m128i lt_r = _mm_and_si128(_mm_cmpgt_epi64(min_r, wait), is_red);
+        __m128i lt_b = _mm_andnot_si128(is_red, _mm_cmpgt_epi64(min_b, wait));
+        __m128i gt_r = _mm_and_si128(_mm_cmpgt_epi64(wait, max_r), is_red);
+        __m128i gt_b = _mm_andnot_si128(is_red, _mm_cmpgt_epi64(wait, max_b));
+        min_r = _mm_blendv_epi8(min_r, wait, lt_r);
+        min_b = _mm_blendv_epi8(min_b, wait, lt_b);
+        max_r = _mm_blendv_epi8(max_r, wait, gt_r);
+        max_b = _mm_blendv_epi8(max_b, wait, gt_b);
+
+        __m128i bin = _mm_srli_epi64(wait, HIST_SHIFT);
+        bin = _mm_blendv_epi8(bin, max_bin, _mm_cmpgt_epi64(bin, max_bin));
+        _mm_storeu_si128((__m128i*)bins, bin);
+        acc->hist[block->color[i]][bins[0]]++;
+        acc->hist[block->color[i + 1]][bins[1]]++;
+    }
+
+    int64_t lanes[8][2];
+    _mm_storeu_si128((__m128i*)lanes[0], red_wait);
+    _mm_storeu_si128((__m128i*)lanes[1], all_wait);
+    _mm_storeu_si128((__m128i*)lanes[2], red_stay);
+    _mm_storeu_si128((__m128i*)lanes[3], all_stay);
+    _mm_storeu_si128((__m128i*)lanes[4], red_n);
+    _mm_storeu_si128((__m128i*)lanes[5], min_r);
+    _mm_storeu_si128((__m128i*)lanes[6], min_b);
+    _mm_storeu_si128((__m128i*)lanes[7], max_r);
+    int64_t reds = lanes[4][0] + lanes[4][1];
+    acc->count[RED] += reds;
+    acc->count[BLUE] += n - reds;
+    acc->wait_sum[RED] += lanes[0][0] + lanes[0][1];
+    acc->wait_sum[BLUE] += lanes[1][0] + lanes[1][1] - lanes[0][0] - lanes[0][1];
+    acc->stay_sum[RED] += lanes[2][0] + lanes[2][1];
+    acc->stay_sum[BLUE] += lanes[3][0] + lanes[3][1] - lanes[2][0] - lanes[2][1];
+    for (int l = 0; l < 2; l++) {
+        if (lanes[5][l] < acc->wait_min[RED]) acc->wait_min[RED] = lanes[5][l];
+        if (lanes[6][l] < acc->wait_min[BLUE]) acc->wait_min[BLUE] = lanes[6][l];
+        if (lanes[7][l] > acc->wait_max[RED]) acc->wait_max[RED] = lanes[7][l];
+    }
+    _mm_storeu_si128((__m128i*)lanes[0], max_b);
+    for (int l = 0; l < 2; l++) {
+        if (lanes[0][l] > acc->wait_max[BLUE]) acc->wait_max[BLUE] = lanes[0][l];
+    }
+
+    stats_scalar_range(acc, block, n);
+    add_occupancy(acc, block);
+}
+
+/* AVX2: four records per step */
+__attribute__((target("avx2")))
+void stats_avx2(StatsAccum* acc, const RecordBlock* block) {
+    const __m256i max_bin = _mm256_set1_epi64x(HIST_BINS - 1);
+    __m256i red_wait = _mm256_setzero_si256(), all_wait = _mm256_setzero_si256();
+    __m256i red_stay = _mm256_setzero_si256(), all_stay = _mm256_setzero_si256();
+    __m256i red_n = _mm256_setzero_si256();
+    __m256i min_r = _mm256_set1_epi64x(INT64_MAX), min_b = min_r;
+    __m256i max_r = _mm256_set1_epi64x(INT64_MIN), max_b = max_r;
+    int64_t n = block->count & ~(int64_t)3;
+    int64_t bins[4];
+
+    for (int64_t i = 0; i < n; i += 4) {
+        __m256i arrival = _mm256_loadu_si256((const __m256i*)(block->arrival + i));
+        __m256i seat = _mm256_loadu_si256((const __m256i*)(block->seat + i));
+        __m256i leave = _mm256_loadu_si256((const __m256i*)(block->leave + i));
+        uint32_t colors;
+        memcpy(&colors, block->color + i, sizeof(colors));
+        __m256i is_red = _mm256_cmpeq_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128(colors)),
+                                            _mm256_setzero_si256());
+
+        __m256i wait = _mm256_sub_epi64(seat, arrival);
+        __m256i stay = _mm256_sub_epi64(leave, seat);
+        all_wait = _mm256_add_epi64(all_wait, wait);
+        all_stay = _mm256_add_epi64(all_stay, stay);
+        red_wait = _mm256_add_epi64(red_wait, _mm256_and_si256(wait, is_red));
+        red_stay = _mm256_add_epi64(red_stay, _mm256_and_si256(stay, is_red));
+        red_n = _mm256_sub_epi64(red_n, is_red);
+
+        __m256i lt_r = _mm256_and_si256(_mm256_cmpgt_epi64(min_r, wait), is_red);
+        __m256i lt_b = _mm256_andnot_si256(is_red, _mm256_cmpgt_epi64(min_b, wait));
+        __m256i gt_r = _mm256_and_si256(_mm256_cmpgt_epi64(wait, max_r), is_red);
+        __m256i gt_b = _mm256_andnot_si256(is_red, _mm256_cmpgt_epi64(wait, max_b));
+        min_r = _mm256_blendv_epi8(min_r, wait, lt_r);
+        min_b = _mm256_blendv_epi8(min_b, wait, lt_b);
+        max_r = _mm256_blendv_epi8(max_r, wait, gt_r);
+        max_b = _mm256_blendv_epi8(max_b, wait, gt_b);
+
+        __m256i bin = _mm256_srli_epi64(wait, HIST_SHIFT);
+        bin = _mm256_blendv_epi8(bin, max_bin, _mm256_cmpgt_epi64(bin, max_bin));
+        _mm256_storeu_si256((__m256i*)bins, bin);
+        for (int l = 0; l < 4; l++) {
+            acc->hist[block->color[i + l]][bins[l]]++;
+        }
+    }
+
+    int64_t lanes[9][4];
+    _mm256_storeu_si256((__m256i*)lanes[0], red_wait);
+    _mm256_storeu_si256((__m256i*)lanes[1], all_wait);
+    _mm256_storeu_si256((__m256i*)lanes[2], red_stay);
+    _mm256_storeu_si256((__m256i*)lanes[3], all_stay);
+    _mm256_storeu_si256((__m256i*)lanes[4], red_n);
+    _mm256_storeu_si256((__m256i*)lanes[5], min_r);
+    _mm256_storeu_si256((__m256i*)lanes[6], min_b);
+    _mm256_storeu_si256((__m256i*)lanes[7], max_r);
+    _mm256_storeu_si256((__m256i*)lanes[8], max_b);
+    int64_t sums[5] = { 0 };
+    for (int l = 0; l < 4; l++) {
+        for (int k = 0; k < 5; k++) {
+            sums[k] += lanes[k][l];
+        }
+        if (lanes[5][l] < acc->wait_min[RED]) acc->wait_min[RED] = lanes[5][l];
+        if (lanes[6][l] < acc->wait_min[BLUE]) acc->wait_min[BLUE] = lanes[6][l];
+        if (lanes[7][l] > acc->wait_max[RED]) acc->wait_max[RED] = lanes[7][l];
+        if (lanes[8][l] > acc->wait_max[BLUE]) acc->wait_max[BLUE] = lanes[8][l];
+    }
+    acc->count[RED] += sums[4];
+    acc->count[BLUE] += n - sums[4];
+    acc->wait_sum[RED] += sums[0];
+    acc->wait_sum[BLUE] += sums[1] - sums[0];
+    acc->stay_sum[RED] += sums[2];
+    acc->stay_sum[BLUE] += sums[3] - sums[2];
+
+    stats_scalar_range(acc, block, n);
+    add_occupancy(acc, block);
+}
+
+/* Choose a kernel by name, or the best one this CPU supports; NULL if unknown or unsupported */
+StatsKernel pick_kernel(const char* name, const char** chosen) {
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2");
+    bool sse42 = __builtin_cpu_supports("sse4.2");
+
+    if (name == NULL) {
+        name = avx2 ? "avx2" : sse42 ? "sse4.2" : "scalar";
+    }
+    *chosen = name;
+    if (strcmp(name, "avx2") == 0) {
+        return avx2 ? stats_avx2 : NULL;
+    }
+    if (strcmp(name, "sse4.2") == 0) {
+        return sse42 ? stats_sse42 : NULL;
+    }
+    if (strcmp(name, "scalar") == 0) {
+        return stats_scalar;
+    }
+    return NULL;
+}
+
+/* Print the per-color report and the occupancy timeline summary */
+void print_report(const StatsAccum* acc) {
+    const char* names[2] = { "Red", "Blue" };
+
+    for (int c = 0; c < 2; c++) {
+        int64_t n = acc->count[c];
+        printf("%s customers: %lld\n", names[c], (long long)n);
+        if (n == 0) {
+            continue;
+        }
+        printf("  queue wait: avg %.3f s, min %.3f s, max %.3f s\n",
+               acc->wait_sum[c] / (double)n / 1e6, acc->wait_min[c] / 1e6, acc->wait_max[c] / 1e6);
+        printf("  table time: avg %.3f s\n", acc->stay_sum[c] / (double)n / 1e6);
+        printf("  wait histogram (%.2f s bins):", (1 << HIST_SHIFT) / 1e6);
+        int last = HIST_BINS - 1;
+        while (last > 0 && acc->hist[c][last] == 0) {
+            last--;
+        }
+        for (int b = 0; b <= last; b++) {
+            printf(" %lld", (long long)acc->hist[c][b]);
+        }
+        printf("\n");
+    }
+
+    // Prefix sum of the difference array gives customers seated per window
+    int64_t inside = 0, peak = 0, total = 0, peak_window = 0;
+    int64_t windows = acc->last_window + 1;
+    for (int64_t w = 0; w < windows; w++) {
+        inside += acc->occupancy_delta[w];
+        total += inside;
+        if (inside > peak) {
+            peak = inside;
+            peak_window = w;
+        }
+    }
+    if (windows > 0) {
+        printf("Occupancy over %lld windows of %lld s: avg %.2f, peak %lld (window %lld)\n",
+               (long long)windows, (long long)(WINDOW_US / 1000000), total / (double)windows,
+               (long long)peak, (long long)peak_window);
+    }
+}
+
+static double wall_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Release the first n blocks and the block list */
+static void free_records(RecordBlock* blocks, int n) {
+    for (int k = 0; k < n; k++) {
+        free(blocks[k].arrival);
+        free(blocks[k].seat);
+        free(blocks[k].leave);
+        free(blocks[k].color);
+    }
+    free(blocks);
+}
+
+/* Allocate the columns of a block of count records; false if out of memory */
+static bool alloc_block(RecordBlock* b, int64_t count) {
+    b->count = count;
+    b->arrival = malloc(count * sizeof(int64_t));
+    b->seat = malloc(count * sizeof(int64_t));
+    b->leave = malloc(count * sizeof(int64_t));
+    b->color = malloc((count + 7) & ~7);
+    return b->arrival != NULL && b->seat != NULL && b->leave != NULL && b->color != NULL;
+}
+
+/* Load a record file into memory as a list of blocks; NULL if it is unreadable, truncated or corrupt */
+static RecordBlock* load_records(const char* path, int* block_count) {
+    FILE* f = fopen(path, "rb");
+    uint64_t header[2];
+    RecordBlock* blocks = NULL;
+    int n = 0, cap = 0;
+
+    if (f == NULL || fread(header, sizeof(header), 1, f) != 1 || header[0] != RECORD_MAGIC) {
+        fprintf(stderr, "%s is not a record file written by src_des.\n", path);
+        if (f != NULL) {
+            fclose(f);
+        }
+        return NULL;
+    }
+
+    int64_t count;
+    while (fread(&count, sizeof(count), 1, f) == 1) {
+        if (count <= 0 || (uint64_t)count > header[1]) {
+            fprintf(stderr, "Corrupt block in %s.\n", path);
+            fclose(f);
+            free_records(blocks, n);
+            return NULL;
+        }
+        if (n == cap) {
+            int grown = cap ? cap * 2 : 64;
+            RecordBlock* more = realloc(blocks, grown * sizeof(RecordBlock));
+            if (more == NULL) {
+                fprintf(stderr, "Out of memory.\n");
+                fclose(f);
+                free_records(blocks, n);
+                return NULL;
+            }
+            blocks = more;
+            cap = grown;
+        }
+        RecordBlock* b = &blocks[n];
+        size_t padded = (count + 7) & ~7;
+        if (!alloc_block(b, count)) {
+            fprintf(stderr, "Out of memory.\n");
+            fclose(f);
+            free_records(blocks, n + 1);
+            return NULL;
+        }
+        if (fread(b->arrival, sizeof(int64_t), count, f) != (size_t)count ||
+            fread(b->seat, sizeof(int64_t), count, f) != (size_t)count ||
+            fread(b->leave, sizeof(int64_t), count, f) != (size_t)count ||
+            fread(b->color, 1, padded, f) != padded) {
+            fprintf(stderr, "Truncated block in %s.\n", path);
+            fclose(f);
+            free_records(blocks, n + 1);  // Includes the half-read block
+            return NULL;
+        }
+        n++;
+    }
+    fclose(f);
+    *block_count = n;
+    return blocks;
+}
+
+/* Generate plausible records: Poisson arrivals, random waits and stays */
+static RecordBlock* synthesize_records(int64_t total, int* block_count) {
+    int n = (int)((total + SYNTH_BLOCK - 1) / SYNTH_BLOCK);
+    RecordBlock* blocks = calloc(n, sizeof(RecordBlock));
+    if (blocks == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        return NULL;
+    }
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    int64_t now = 0;
+
+    for (int k = 0; k < n; k++) {
+        RecordBlock* b = &blocks[k];
+        int64_t count = total - (int64_t)k * SYNTH_BLOCK;
+        if (count > SYNTH_BLOCK) {
+            count = SYNTH_BLOCK;
+        }
+        if (!alloc_block(b, count)) {
+            fprintf(stderr, "Out of memory.\n");
+            free_records(blocks, k + 1);  // Includes the half-allocated block
+            return NULL;
+        }
+        for (int64_t i = 0; i < count; i++) {
+            x ^= x >> 12;
+            x ^= x << 25;
+            x ^= x >> 27;
+            uint64_t r = x * 0x2545F4914F6CDD1DULL;
+            now += (int64_t)(r & 0xFFFFF);                        // up to ~1 s apart
+            b->arrival[i] = now;
+            b->seat[i] = now + (int64_t)((r >> 20) & 0x3FFFFFF);  // up to ~67 s wait
+            b->leave[i] = b->seat[i] + 1000000 + (int64_t)((r >> 46) & 0x3FFFFF);
+            b->color[i] = (uint8_t)(r >> 63);
+        }
+    }
+    *block_count = n;
+    return blocks;
+}
+
+/* Run one kernel over every block; returns elapsed seconds */
+static double run_kernel(StatsKernel kernel, StatsAccum* acc, const RecordBlock* blocks, int n) {
+    init_accum(acc);
+    double start = wall_clock();
+    for (int k = 0; k < n; k++) {
+        kernel(acc, &blocks[k]);
+    }
+    return wall_clock() - start;
+}
+
+/* Main function - command line driver */
+int main(int argc, char* argv[]) {
+    const char* impl = NULL;
+    const char* path = NULL;
+    int64_t synthetic = 0;
+    bool bench = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--impl") == 0 && i + 1 < argc) {
+            impl = argv[++i];
+        } else if (strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc) {
+            synthetic = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--impl scalar|sse4.2|avx2] [--bench] "
+                            "(RECORD_FILE | --synthetic N)\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int block_count = 0;
+    RecordBlock* blocks;
+    double load_start = wall_clock();
+    if (synthetic > 0) {
+        blocks = synthesize_records(synthetic, &block_count);
+    } else if (path != NULL) {
+        blocks = load_records(path, &block_count);
+    } else {
+        fprintf(stderr, "Give a record file or --synthetic N.\n");
+        return 1;
+    }
+    if (blocks == NULL) {
+        return 1;
+    }
+    int64_t records = 0;
+    for (int k = 0; k < block_count; k++) {
+        records += blocks[k].count;
+    }
+    printf("Loaded %lld records in %d blocks (%.2f s)\n",
+           (long long)records, block_count, wall_clock() - load_start);
+
+    StatsAccum acc;
+    acc.occupancy_delta = malloc(sizeof(int32_t) * (MAX_WINDOWS + 1));
+    if (acc.occupancy_delta == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        free_records(blocks, block_count);
+        return 1;
+    }
+
+    if (bench) {
+        // Every available kernel must produce identical aggregates
+        const char* names[3] = { "scalar", "sse4.2", "avx2" };
+        StatsAccum reference;
+        reference.occupancy_delta = malloc(sizeof(int32_t) * (MAX_WINDOWS + 1));
+        if (reference.occupancy_delta == NULL) {
+            fprintf(stderr, "Out of memory.\n");
+            free_records(blocks, block_count);
+            free(acc.occupancy_delta);
+            return 1;
+        }
+        for (int k = 0; k < 3; k++) {
+            const char* chosen;
+            StatsKernel kernel = pick_kernel(names[k], &chosen);
+            if (kernel == NULL) {
+                printf("%-7s not supported on this CPU\n", names[k]);
+                continue;
+            }
+            StatsAccum* target = k == 0 ? &reference : &acc;
+            double secs = run_kernel(kernel, target, blocks, block_count);
+            bool same = k == 0 ||
+                (memcmp(acc.count, reference.count, offsetof(StatsAccum, occupancy_delta)) == 0 &&
+                 memcmp(acc.occupancy_delta, reference.occupancy_delta,
+                        sizeof(int32_t) * (reference.last_window + 1)) == 0);
+            printf("%-7s %.3f s (%.0f M records/s)%s\n", names[k], secs,
+                   records / secs / 1e6, same ? "" : "  MISMATCH");
+        }
+        free(reference.occupancy_delta);
+    } else {
+        const char* chosen;
+        StatsKernel kernel = pick_kernel(impl, &chosen);
+        if (kernel == NULL) {
+            fprintf(stderr, "Implementation '%s' is unknown or unsupported here.\n", chosen);
+            free_records(blocks, block_count);
+            free(acc.occupancy_delta);
+            return 1;
+        }
+        double secs = run_kernel(kernel, &acc, blocks, block_count);
+        printf("Kernel: %s, %.3f s\n\n", chosen, secs);
+        print_report(&acc);
+    }
+
+    free_records(blocks, block_count);
+    free(acc.occupancy_delta);
+    return 0;
+}
@@ -0,0 +1,528 @@
+/*
+ * Sweet Harmony Bakery - Work-Stealing Customer Scheduler Benchmark
+ *
+ * Customers are small state machines (arrive -> seated -> eating ->
+ * leave) following the rules of src_ds.c: admission needs a free table
+ * and the balance rule, and claims the table in the same step. They run on a pool
+ * of workers, each with its own Chase-Lev work-stealing deque:
+ *
+ *   - a worker pushes and pops customers at the bottom of its own deque,
+ *     so a customer normally runs all of its steps on one core, and
+ *     customers it wakes (admitted from line) stay local
+ *   - an idle worker steals from the top of a random victim's deque
+ *
+ * The bakery is split into SHARD_COUNT stores, each with its own small
+ * lock, and every worker feeds arrivals into the stores it owns. The
+ * model does not change with the thread count, so the benchmark measures
+ * strong scaling. The same workload is also run on one mutex-protected
+ * global run queue (the naive design) for comparison.
+ *
+ * Eating is simulated as CPU work (--work) so traffic is compute-heavy.
+ *
+ * Build: gcc -O2 -Wall -pthread src_steal.c -o src_steal
+ *
+ * Example: ./src_steal --customers 2000000 --max-threads 64
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <time.h>
+
+/* Constants */
+#define SHARD_COUNT 64           // Independent stores; fixed across thread counts
+#define TABLES_PER_SHARD 8
+#define DEQUE_CAPACITY (1 << 14) // Per-worker deque slots (power of two)
+#define ARRIVAL_BATCH 32         // Arrivals released per refill
+#define MAX_WORKERS 256
+#define CACHE_LINE 64
+
+/* Color enumeration */
+typedef enum {
+    RED = 0,
+    BLUE = 1
+} CustomerColor;
+
+/* Customer state machine */
+typedef enum {
+    ST_ARRIVE = 0,               // Needs admission (free table and balance rule)
+    ST_EAT,                      // Admitted and seated
+    ST_LEAVE                     // Finished eating
+} CustomerState;
+
+typedef struct Customer {
+    CustomerState state;
+    CustomerColor color;
+    int shard;
+    int work;                    // Eating cost in mix iterations
+    struct Customer* next;       // Intrusive link for shard wait lists
+} Customer;
+
+/* Intrusive FIFO of parked customers */
+typedef struct {
+    Customer* head;
+    Customer* tail;
+    long size;
+} CustomerList;
+
+/* One store: the src_ds.c bakery state behind its own lock */
+typedef struct {
+    pthread_mutex_t lock;
+    int free_tables;
+    int red_count;
+    int blue_count;
+    int customers_inside;
+    CustomerList waiting[2];
+    char pad[CACHE_LINE];        // Keep neighbouring shards off this cache line
+} Shard;
+
+/* Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models") */
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_long top;     // Thieves take from here
+    _Alignas(CACHE_LINE) atomic_long bottom;  // Owner pushes/pops here
+    _Alignas(CACHE_LINE) Customer* _Atomic slots[DEQUE_CAPACITY];
+} Deque;
+
+/* Per-worker state */
+typedef struct {
+    _Alignas(CACHE_LINE) int index;
+    struct Bench* bench;
+    Deque deque;
+    CustomerList overflow;       // Runnable customers that did not fit the deque
+    uint64_t rng;
+    long steals;
+    long completed;
+} Worker;
+
+/* Naive baseline: one locked FIFO shared by every worker */
+typedef struct {
+    pthread_mutex_t lock;
+    Customer** slots;
+    long capacity;
+    long head;
+    long size;
+} GlobalQueue;
+
+/* Benchmark run */
+typedef struct Bench {
+    int threads;
+    bool global;                 // Use the global queue instead of stealing
+    long total;
+    Customer* customers;
+    Shard shards[SHARD_COUNT];
+    long next_arrival[SHARD_COUNT];   // Next customer index per shard (owner only)
+    long shard_end[SHARD_COUNT];
+    Worker* workers;
+    GlobalQueue queue;
+    _Alignas(CACHE_LINE) atomic_long completed;
+} Bench;
+
+/* Function prototypes */
+bool deque_push(Deque* d, Customer* c);
+Customer* deque_take(Deque* d);
+Customer* deque_steal(Deque* d);
+bool step(Bench* b, Worker* w, Customer* c);
+void* worker_main(void* arg);
+void make_runnable(Bench* b, Worker* w, Customer* c);
+double run_bench(Bench* b, int threads, bool global, long* steals);
+
+/* Owner only: push at the bottom; false if the deque is full */
+bool deque_push(Deque* d, Customer* c) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= DEQUE_CAPACITY) {
+        return false;
+    }
+    atomic_store_explicit(&d->slots[b & (DEQUE_CAPACITY - 1)], c, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+/* Owner only: pop the most recently pushed customer */
+Customer* deque_take(Deque* d) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    Customer* c = atomic_load_explicit(&d->slots[b & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (t == b) {
+        // Last element: race any thief for it
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed)) {
+            c = NULL;
+        }
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return c;
+}
+
+/* Any thread: take the oldest customer; NULL if empty or the race was lost */
+Customer* deque_steal(Deque* d) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+    if (t >= b) {
+        return NULL;
+    }
+    Customer* c = atomic_load_explicit(&d->slots[t & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return c;
+}
+
+static void list_push(CustomerList* list, Customer* c) {
+    c->next = NULL;
+    if (list->tail != NULL) {
+        list->tail->next = c;
+    } else {
+        list->head = c;
+    }
+    list->tail = c;
+    list->size++;
+}
+
+static Customer* list_pop(CustomerList* list) {
+    Customer* c = list->head;
+    if (c != NULL) {
+        list->head = c->next;
+        if (list->head == NULL) {
+            list->tail = NULL;
+        }
+        list->size--;
+    }
+    return c;
+}
+
+/* Check if a customer of given color can enter based on balance rule */
+static bool can_enter(Shard* s, CustomerColor color) {
+    if (s->free_tables == 0) {
+        return false;
+    }
+    if (s->customers_inside == 0) {
+        return true;
+    }
+    return color == RED ? s->red_count < s->blue_count : s->blue_count < s->red_count;
+}
+
+/* Count a customer as inside, at the table they were admitted to */
+static void enter_shard(Shard* s, CustomerColor color) {
+    s->free_tables--;
+    if (color == RED) {
+        s->red_count++;
+    } else {
+        s->blue_count++;
+    }
+    s->customers_inside++;
+}
+
+/* Seat waiting customers while tables are free and make them runnable on this worker */
+static void try_balance_entry(Bench* b, Worker* w, Shard* s) {
+    while (s->free_tables > 0) {
+        CustomerList* line = NULL;
+        if (s->customers_inside == 0 || s->red_count == s->blue_count) {
+            if (s->waiting[RED].size > 0 || s->waiting[BLUE].size > 0) {
+                line = s->waiting[RED].size >= s->waiting[BLUE].size ? &s->waiting[RED] : &s->waiting[BLUE];
+            }
+        } else if (s->red_count < s->blue_count && s->waiting[RED].size > 0) {
+            line = &s->waiting[RED];
+        } else if (s->blue_count < s->red_count && s->waiting[BLUE].size > 0) {
+            line = &s->waiting[BLUE];
+        }
+        if (line == NULL) {
+            return;
+        }
+        Customer* c = list_pop(line);
+        enter_shard(s, c->color);
+        c->state = ST_EAT;
+        make_runnable(b, w, c);
+    }
+}
+
+/* Simulated eating: a dependent chain of integer mixes the compiler cannot drop */
+static uint64_t eat(int work, uint64_t x) {
+    for (int i = 0; i < work; i++) {
+        x = (x ^ (x >> 31)) * 0x9E3779B97F4A7C15ULL;
+    }
+    return x;
+}
+
+static _Thread_local uint64_t eat_sink;
+
+/*
+ * Advance a customer by one step. Returns true if it is still runnable;
+ * false if it parked on a shard list or finished. Customers it wakes are
+ * queued on the calling worker so they keep running on this core.
+ */
+bool step(Bench* b, Worker* w, Customer* c) {
+    Shard* s = &b->shards[c->shard];
+
+    switch (c->state) {
+    case ST_ARRIVE:
+        pthread_mutex_lock(&s->lock);
+        if (s->waiting[c->color].size == 0 && can_enter(s, c->color)) {
+            enter_shard(s, c->color);
+            c->state = ST_EAT;
+            pthread_mutex_unlock(&s->lock);
+            return true;
+        }
+        list_push(&s->waiting[c->color], c);
+        pthread_mutex_unlock(&s->lock);
+        return false;
+
+    case ST_EAT:
+        eat_sink += eat(c->work, (uint64_t)(uintptr_t)c);
+        c->state = ST_LEAVE;
+        return true;
+
+    case ST_LEAVE: {
+        pthread_mutex_lock(&s->lock);
+        if (c->color == RED) {
+            s->red_count--;
+        } else {
+            s->blue_count--;
+        }
+        s->customers_inside--;
+        s->free_tables++;
+        try_balance_entry(b, w, s);
+        pthread_mutex_unlock(&s->lock);
+        atomic_fetch_add_explicit(&b->completed, 1, memory_order_relaxed);
+        return false;
+    }
+    }
+    return false;
+}
+
+/* Global-queue baseline operations */
+static void global_push(GlobalQueue* q, Customer* c) {
+    pthread_mutex_lock(&q->lock);
+    q->slots[(q->head + q->size) % q->capacity] = c;
+    q->size++;
+    pthread_mutex_unlock(&q->lock);
+}
+
+static Customer* global_pop(GlobalQueue* q) {
+    Customer* c = NULL;
+    pthread_mutex_lock(&q->lock);
+    if (q->size > 0) {
+        c = q->slots[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->size--;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return c;
+}
+
+/* Queue a runnable customer on this worker (or the global queue) */
+void make_runnable(Bench* b, Worker* w, Customer* c) {
+    if (b->global) {
+        global_push(&b->queue, c);
+    } else if (!deque_push(&w->deque, c)) {
+        list_push(&w->overflow, c);
+    }
+}
+
+/* Release the next batch of arrivals from this worker's shards; returns count */
+static int release_arrivals(Bench* b, Worker* w) {
+    int released = 0;
+    for (int s = w->index; s < SHARD_COUNT && released < ARRIVAL_BATCH; s += b->threads) {
+        while (b->next_arrival[s] < b->shard_end[s] && released < ARRIVAL_BATCH) {
+            make_runnable(b, w, &b->customers[b->next_arrival[s]++]);
+            released++;
+        }
+    }
+    return released;
+}
+
+/* Worker loop: run local work, refill arrivals, otherwise steal */
+void* worker_main(void* arg) {
+    Worker* w = (Worker*)arg;
+    Bench* b = w->bench;
+    int idle_rounds = 0;
+
+    while (atomic_load_explicit(&b->completed, memory_order_relaxed) < b->total) {
+        Customer* c = b->global ? global_pop(&b->queue) : deque_take(&w->deque);
+
+        if (c == NULL && w->overflow.size > 0) {
+            c = list_pop(&w->overflow);
+        }
+        if (c == NULL) {
+            if (release_arrivals(b, w) > 0) {
+                continue;
+            }
+            if (!b->global && b->threads > 1) {
+                // Steal from a random victim
+                w->rng ^= w->rng << 13;
+                w->rng ^= w->rng >> 7;
+                w->rng ^= w->rng << 17;
+                int victim = (int)(w->rng % b->threads);
+                if (victim != w->index) {
+                    c = deque_steal(&b->workers[victim].deque);
+                    if (c != NULL) {
+                        w->steals++;
+                    }
+                }
+            }
+            if (c == NULL) {
+                if (++idle_rounds > 64) {
+                    sched_yield();
+                    idle_rounds = 0;
+                }
+                continue;
+            }
+        }
+        idle_rounds = 0;
+
+        // Run the customer as far as it goes without requeueing
+        while (step(b, w, c)) {
+        }
+    }
+    return NULL;
+}
+
+static double wall_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Run the full workload once; returns elapsed seconds */
+double run_bench(Bench* b, int threads, bool global, long* steals) {
+    pthread_t tids[MAX_WORKERS];
+
+    b->threads = threads;
+    b->global = global;
+    atomic_store(&b->completed, 0);
+
+    // Reset customers and shards so every run sees the same model
+    for (long i = 0; i < b->total; i++) {
+        b->customers[i].state = ST_ARRIVE;
+    }
+    long per_shard = b->total / SHARD_COUNT;
+    for (int s = 0; s < SHARD_COUNT; s++) {
+        Shard* sh = &b->shards[s];
+        memset(sh->waiting, 0, sizeof(sh->waiting));
+        sh->free_tables = TABLES_PER_SHARD;
+        sh->red_count = sh->blue_count = sh->customers_inside = 0;
+        b->next_arrival[s] = s * per_shard;
+        b->shard_end[s] = s == SHARD_COUNT - 1 ? b->total : (s + 1) * per_shard;
+    }
+    b->queue.head = b->queue.size = 0;
+
+    b->workers = aligned_alloc(CACHE_LINE, sizeof(Worker) * threads);
+    for (int k = 0; k < threads; k++) {
+        memset(&b->workers[k], 0, sizeof(Worker));
+        b->workers[k].index = k;
+        b->workers[k].bench = b;
+        b->workers[k].rng = 0x9E3779B97F4A7C15ULL * (k + 1);
+    }
+
+    double start = wall_clock();
+    for (int k = 0; k < threads; k++) {
+        pthread_create(&tids[k], NULL, worker_main, &b->workers[k]);
+    }
+    for (int k = 0; k < threads; k++) {
+        pthread_join(tids[k], NULL);
+    }
+    double elapsed = wall_clock() - start;
+
+    *steals = 0;
+    for (int k = 0; k < threads; k++) {
+        *steals += b->workers[k].steals;
+    }
+    free(b->workers);
+    return elapsed;
+}
+
+/* Main function - benchmark driver */
+int main(int argc, char* argv[]) {
+    long total = 1000000;
+    int max_threads = 64;
+    int work = 2000;
+
+    for (int i = 1; i < argc; i++) {
+        const char* val = i + 1 < argc ? argv[i + 1] : "";
+        if (strcmp(argv[i], "--customers") == 0) {
+            total = atol(val);
+            i++;
+        } else if (strcmp(argv[i], "--max-threads") == 0) {
+            max_threads = atoi(val);
+            i++;
+        } else if (strcmp(argv[i], "--work") == 0) {
+            work = atoi(val);
+            i++;
+        } else {
+            fprintf(stderr, "Usage: %s [--customers N] [--max-threads N] [--work N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (total < SHARD_COUNT || max_threads < 1 || max_threads > MAX_WORKERS) {
+        fprintf(stderr, "Need at least %d customers and 1..%d threads.\n", SHARD_COUNT, MAX_WORKERS);
+        return 1;
+    }
+
+    Bench* b = aligned_alloc(CACHE_LINE, sizeof(Bench));
+    memset(b, 0, sizeof(*b));
+    b->total = total;
+    b->customers = malloc(sizeof(Customer) * total);
+    b->queue.capacity = total;
+    b->queue.slots = malloc(sizeof(Customer*) * total);
+    pthread_mutex_init(&b->queue.lock, NULL);
+    for (int s = 0; s < SHARD_COUNT; s++) {
+        pthread_mutex_init(&b->shards[s].lock, NULL);
+    }
+
+    // Fixed workload: colors, eating costs and shards do not depend on threads
+    uint64_t x = 0x2545F4914F6CDD1DULL;
+    long per_shard = total / SHARD_COUNT;
+    for (long i = 0; i < total; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        b->customers[i].color = (x >> 63) ? BLUE : RED;
+        b->customers[i].work = work / 2 + (int)(x % (work + 1));
+        b->customers[i].shard = i / per_shard < SHARD_COUNT ? (int)(i / per_shard) : SHARD_COUNT - 1;
+    }
+
+    printf("%ld customers, %d shards x %d tables, ~%d work units each, %ld CPUs online\n\n",
+           total, SHARD_COUNT, TABLES_PER_SHARD, work, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%8s %14s %9s %12s %14s\n", "threads", "steal M/s", "speedup", "steals", "global-q M/s");
+
+    double base = 0.0;
+    // Doubling sweep that always finishes on max_threads
+    for (int threads = 1; threads <= max_threads;
+         threads = threads < max_threads && threads * 2 > max_threads ? max_threads : threads * 2) {
+        long steals = 0, unused = 0;
+        double t_steal = run_bench(b, threads, false, &steals);
+        double t_global = run_bench(b, threads, true, &unused);
+        double rate = total / t_steal / 1e6;
+        if (threads == 1) {
+            base = rate;
+        }
+        printf("%8d %14.3f %8.2fx %12ld %14.3f\n", threads, rate, rate / base, steals,
+               total / t_global / 1e6);
+    }
+
+    for (int s = 0; s < SHARD_COUNT; s++) {
+        pthread_mutex_destroy(&b->shards[s].lock);
+    }
+    pthread_mutex_destroy(&b->queue.lock);
+    free(b->queue.slots);
+    free(b->customers);
+    free(b);
+    return 0;
+}